@@ -0,0 +1,154 @@
+#include "anomaly_detector.h"
+#include <math.h>
+#include <string.h>
+
+static const float MIN_SIGMA[SEASONAL_STREAMS] = {ANOMALY_MIN_SIGMA_I, ANOMALY_MIN_SIGMA_P};
+
+AnomalyDetector::AnomalyDetector() {
+    reset();
+}
+
+void AnomalyDetector::reset() {
+    _voltage_mean = 0;
+    _voltage_var = 0;
+    _windows = 0;
+    memset(_over, 0, sizeof(_over));
+    memset(_slots, 0, sizeof(_slots));
+    _hour = 0;
+    memset(_hour_sum, 0, sizeof(_hour_sum));
+    memset(_hour_sum_sq, 0, sizeof(_hour_sum_sq));
+    _hour_windows = 0;
+    memset(_active, 0, sizeof(_active));
+    memset(_z, 0, sizeof(_z));
+    memset(_events, 0, sizeof(_events));
+    _event_head = 0;
+    _event_count = 0;
+    _total_events = 0;
+}
+
+bool AnomalyDetector::update(uint32_t now_s, float voltage, float current, float power) {
+    bool logged = false;
+
+    if (_windows == 0) {
+        _voltage_mean = voltage;
+        _hour = now_s / 3600;
+    }
+    if (_windows < ANOMALY_WARMUP) _windows++;
+
+    // Voltage: score against the EWMA before folding the sample in
+    float sigma = sqrtf(_voltage_var);
+    if (sigma < ANOMALY_MIN_SIGMA_V) sigma = ANOMALY_MIN_SIGMA_V;
+    float diff = voltage - _voltage_mean;
+    float increment = ANOMALY_EWMA_ALPHA * diff;
+    _voltage_mean += increment;
+    _voltage_var = (1.0f - ANOMALY_EWMA_ALPHA) * (_voltage_var + diff * increment);
+    if (_windows >= ANOMALY_WARMUP) {
+        logged |= judge(ANOMALY_VOLTAGE, now_s, voltage, _voltage_mean, diff / sigma, ANOMALY_PERSIST_V);
+    }
+
+    uint32_t hour = now_s / 3600;
+    if (hour != _hour) {
+        logged |= closeHour(now_s);
+        _hour = hour;
+    }
+
+    // Current and power: score against this hour's baseline once it has history
+    float values[SEASONAL_STREAMS] = {current, power};
+    uint8_t slot = hour % HOURS_PER_DAY;
+    for (uint8_t s = 0; s < SEASONAL_STREAMS; s++) {
+        _hour_sum[s] += values[s];
+        _hour_sum_sq[s] += values[s] * values[s];
+
+        const HourBaseline& base = _slots[s][slot];
+        if (base.days < ANOMALY_SEASONAL_WARMUP) continue;
+        float spread = sqrtf(base.window_var);
+        if (spread < MIN_SIGMA[s]) spread = MIN_SIGMA[s];
+        float z = (values[s] - base.mean) / spread;
+        logged |= judge(ANOMALY_CURRENT + s, now_s, values[s], base.mean, z, ANOMALY_PERSIST_LOAD);
+    }
+    _hour_windows++;
+
+    return logged;
+}
+
+bool AnomalyDetector::judge(uint8_t kind, uint32_t now_s, float value, float expected, float z, uint16_t persist) {
+    _z[kind] = z;
+
+    if (fabsf(z) >= ANOMALY_Z_THRESHOLD) {
+        if (_over[kind] < persist) _over[kind]++;
+        if (_over[kind] == persist && !_active[kind]) {
+            _active[kind] = true;
+            logEvent(now_s, kind, value, expected, z);
+            return true;
+        }
+    } else {
+        _over[kind] = 0;
+        if (fabsf(z) <= ANOMALY_Z_CLEAR) _active[kind] = false;
+    }
+    return false;
+}
+
+bool AnomalyDetector::closeHour(uint32_t now_s) {
+    if (_hour_windows == 0) return false;
+
+    uint8_t slot = _hour % HOURS_PER_DAY;
+    bool logged = false;
+
+    for (uint8_t s = 0; s < SEASONAL_STREAMS; s++) {
+        HourBaseline& base = _slots[s][slot];
+        float mean = _hour_sum[s] / _hour_windows;
+        float window_var = _hour_sum_sq[s] / _hour_windows - mean * mean;
+        if (window_var < 0) window_var = 0;
+        _hour_sum[s] = 0;
+        _hour_sum_sq[s] = 0;
+
+        if (base.days == 0) {
+            base.mean = mean;
+            base.window_var = window_var;
+        } else {
+            float diff = mean - base.mean;
+
+            // Slow base-load creep shows up as a shifted hourly average
+            if (s == ANOMALY_POWER - ANOMALY_CURRENT && base.days >= ANOMALY_SEASONAL_WARMUP) {
+                float sigma = sqrtf(base.hourly_var);
+                if (sigma < ANOMALY_MIN_SIGMA_P) sigma = ANOMALY_MIN_SIGMA_P;
+                float z = diff / sigma;
+                _z[ANOMALY_BASELOAD] = z;
+                bool anomalous = fabsf(z) >= ANOMALY_BASELOAD_Z;
+                if (anomalous && !_active[ANOMALY_BASELOAD]) {
+                    logEvent(now_s, ANOMALY_BASELOAD, mean, base.mean, z);
+                    logged = true;
+                }
+                _active[ANOMALY_BASELOAD] = anomalous;
+            }
+
+            float increment = ANOMALY_SEASONAL_ALPHA * diff;
+            base.mean += increment;
+            base.hourly_var = (1.0f - ANOMALY_SEASONAL_ALPHA) * (base.hourly_var + diff * increment);
+            base.window_var += ANOMALY_SEASONAL_ALPHA * (window_var - base.window_var);
+        }
+        if (base.days < UINT8_MAX) base.days++;
+    }
+
+    _hour_windows = 0;
+    return logged;
+}
+
+void AnomalyDetector::logEvent(uint32_t now_s, uint8_t kind, float value, float expected, float z) {
+    AnomalyEvent& event = _events[_event_head];
+    event.time = now_s;
+    event.kind = kind;
+    event.value = value;
+    event.expected = expected;
+    event.z = z;
+
+    _total_events++;
+    _event_head = (_event_head + 1) % ANOMALY_EVENT_LOG;
+    if (_event_count < ANOMALY_EVENT_LOG) _event_count++;
+}
+
+bool AnomalyDetector::getEvent(uint8_t age, AnomalyEvent& out) const {
+    if (age >= _event_count) return false;
+    out = _events[(_event_head + ANOMALY_EVENT_LOG - 1 - age) % ANOMALY_EVENT_LOG];
+    return true;
+}
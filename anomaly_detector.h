@@ -0,0 +1,92 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <stdint.h>
+
+// Anomaly Kinds
+#define ANOMALY_VOLTAGE  0      // Window voltage against its EWMA baseline
+#define ANOMALY_CURRENT  1      // Window current against its hour-of-day baseline
+#define ANOMALY_POWER    2      // Window power against its hour-of-day baseline
+#define ANOMALY_BASELOAD 3      // Hourly average power drifting from its hour baseline
+#define ANOMALY_KINDS    4
+#define SEASONAL_STREAMS 2      // Current and power
+
+// Voltage EWMA
+#define ANOMALY_EWMA_ALPHA 0.002    // ~500 window memory (~50 s at 100 ms)
+#define ANOMALY_WARMUP 600          // Windows before voltage is judged
+#define ANOMALY_MIN_SIGMA_V 1.0     // Floors keep z finite on flat signals
+#define ANOMALY_MIN_SIGMA_I 0.05
+#define ANOMALY_MIN_SIGMA_P 10.0
+
+// Thresholds
+#define ANOMALY_Z_THRESHOLD 5.0     // |z| that counts towards an anomaly
+#define ANOMALY_Z_CLEAR 2.0         // |z| that ends it
+#define ANOMALY_PERSIST_V 10        // Windows over threshold to flag voltage (~1 s)
+#define ANOMALY_PERSIST_LOAD 3000   // Windows over threshold to flag I/P (~5 min)
+#define ANOMALY_BASELOAD_Z 3.0      // |z| of an hourly average that is flagged
+
+// Hour-of-day Baselines
+#define HOURS_PER_DAY 24
+#define ANOMALY_SEASONAL_ALPHA 0.2  // Weight of each new day in the baseline
+#define ANOMALY_SEASONAL_WARMUP 3   // Days of history per hour before judging
+#define ANOMALY_EVENT_LOG 16
+
+struct AnomalyEvent {
+    uint32_t time;              // Seconds since epoch
+    uint8_t kind;               // ANOMALY_VOLTAGE .. ANOMALY_BASELOAD
+    float value;                // Observed value
+    float expected;             // Baseline mean
+    float z;                    // Standardized deviation
+};
+
+// Always-on detector over the V/I/P window stream. Voltage is scored
+// against an EWMA mean/variance; current and power against per hour-of-day
+// baselines of window mean and spread learned across days, so the daily
+// load pattern is not itself anomalous. Hourly average power is also
+// compared with its baseline to catch slow base-load creep.
+// Fixed memory, no allocation, a few flops per window.
+class AnomalyDetector {
+public:
+    AnomalyDetector();
+    void reset();
+    bool update(uint32_t now_s, float voltage, float current, float power); // True if an event was logged
+
+    bool isActive(uint8_t kind) const { return kind < ANOMALY_KINDS && _active[kind]; }
+    float getZScore(uint8_t kind) const { return kind < ANOMALY_KINDS ? _z[kind] : 0; }
+    float getHourBaseline(uint8_t hour) const { return hour < HOURS_PER_DAY ? _slots[1][hour].mean : 0; }
+    uint8_t getEventCount() const { return _event_count; }
+    bool getEvent(uint8_t age, AnomalyEvent& out) const;     // age 0 = newest
+    uint32_t getTotalEvents() const { return _total_events; }
+
+private:
+    struct HourBaseline {
+        float mean;             // Mean window value in this hour
+        float window_var;       // Window-to-window variance within the hour
+        float hourly_var;       // Day-to-day variance of the hour mean
+        uint8_t days;           // Days folded in
+    };
+
+    float _voltage_mean;
+    float _voltage_var;
+    uint32_t _windows;                   // Windows seen, saturates at warmup
+    uint16_t _over[ANOMALY_KINDS];       // Consecutive windows over threshold
+
+    HourBaseline _slots[SEASONAL_STREAMS][HOURS_PER_DAY];
+    uint32_t _hour;                      // Hour number being accumulated
+    float _hour_sum[SEASONAL_STREAMS];   // Sums for the current hour
+    float _hour_sum_sq[SEASONAL_STREAMS];
+    uint32_t _hour_windows;
+
+    bool _active[ANOMALY_KINDS];
+    float _z[ANOMALY_KINDS];
+    AnomalyEvent _events[ANOMALY_EVENT_LOG];
+    uint8_t _event_head;
+    uint8_t _event_count;
+    uint32_t _total_events;
+
+    bool judge(uint8_t kind, uint32_t now_s, float value, float expected, float z, uint16_t persist);
+    bool closeHour(uint32_t now_s);
+    void logEvent(uint32_t now_s, uint8_t kind, float value, float expected, float z);
+};
+
+#endif
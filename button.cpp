@@ -66,6 +66,10 @@ bool Button::wasReleased() {
     return result;
 }
 
+bool Button::isSettling() const {
+    return _lastState != _currentState;
+}
+
 bool Button::isLongPress() {
     return _longPressDetected;
 }
@@ -16,6 +16,7 @@ public:
     bool wasPressed();          // True if button was just pressed
     bool wasReleased();        // True if button was just released
     bool isLongPress();        // Check for long press
+    bool isSettling() const;   // Input differs from the debounced state
     unsigned long getPressTime() const;  // How long button has been pressed
 
 private:
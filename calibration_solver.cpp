@@ -0,0 +1,137 @@
+#include "calibration_solver.h"
+#include <math.h>
+#include <string.h>
+
+CalibrationSolver::CalibrationSolver() {
+    reset();
+}
+
+void CalibrationSolver::reset() {
+    memset(_steps, 0, sizeof(_steps));
+    _count = 0;
+    _running = false;
+    _start_ms = 0;
+}
+
+bool CalibrationSolver::beginStep(float ref_voltage, float ref_current, float ref_power, uint32_t now_ms) {
+    if (_count >= CAL_MAX_STEPS || ref_voltage < 0 || ref_current < 0) return false;
+
+    CalibrationStep& step = _steps[_count];
+    memset(&step, 0, sizeof(step));
+    step.ref_voltage = ref_voltage;
+    step.ref_current = ref_current;
+    step.ref_power = ref_power;
+    _sum_v = _sum_p = _sum_q = 0;
+    _mean_i = _m2_i = 0;
+    _start_ms = now_ms;
+    _running = true;
+    return true;
+}
+
+bool CalibrationSolver::addWindow(float voltage, float current, float power, float reactive, uint32_t now_ms) {
+    if (!_running) return false;
+
+    CalibrationStep& step = _steps[_count];
+    step.windows++;
+    _sum_v += voltage;
+    _sum_p += power;
+    _sum_q += reactive;
+    double delta = current - _mean_i;
+    _mean_i += delta / step.windows;
+    _m2_i += delta * (current - _mean_i);
+
+    double n = step.windows;
+    step.voltage = _sum_v / n;
+    step.current = _mean_i;
+    step.power = _sum_p / n;
+    step.reactive = _sum_q / n;
+    step.current_sem = n > 1 ? sqrt(_m2_i / (n - 1) / n) : 0;
+    step.duration_ms = now_ms - _start_ms;
+
+    float scale = step.current > CAL_MIN_CURRENT ? step.current : CAL_MIN_CURRENT;
+    step.converged = step.windows >= CAL_MIN_WINDOWS && step.current_sem < CAL_TARGET_REL * scale;
+    if (!step.converged && step.windows < CAL_MAX_WINDOWS) return false;
+
+    _running = false;
+    _count++;
+    return true;
+}
+
+bool CalibrationSolver::solve(CalibrationResult& result) const {
+    memset(&result, 0, sizeof(result));
+    result.voltage_gain = 1.0f;
+    if (_count == 0) return false;
+
+    // Voltage: least squares line through the steps, gain only if one point
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint8_t vn = 0;
+    for (uint8_t s = 0; s < _count; s++) {
+        const CalibrationStep& step = _steps[s];
+        if (step.ref_voltage <= 0 || step.voltage <= 0) continue;
+        sx += step.voltage;
+        sy += step.ref_voltage;
+        sxx += step.voltage * step.voltage;
+        sxy += step.voltage * step.ref_voltage;
+        vn++;
+    }
+    double vden = vn * sxx - sx * sx;
+    if (vn >= 2 && vden > 1e-6 * sxx * vn) {
+        result.voltage_gain = (vn * sxy - sx * sy) / vden;
+        result.voltage_offset = (sy - result.voltage_gain * sx) / vn;
+    } else if (vn > 0) {
+        result.voltage_gain = sy / sx;
+    }
+
+    // Current: measured^2 = ref^2 / g^2 + offset^2. Two or more distinct
+    // loads give the offset left in the readings (noise not removed by the
+    // noise floor); a large value means the floor or bias is off.
+    double ax = 0, ay = 0, axx = 0, axy = 0;
+    uint8_t in = 0;
+    for (uint8_t s = 0; s < _count; s++) {
+        double x = (double)_steps[s].ref_current * _steps[s].ref_current;
+        double y = (double)_steps[s].current * _steps[s].current;
+        ax += x; ay += y; axx += x * x; axy += x * y;
+        in++;
+    }
+    double iden = in * axx - ax * ax;
+    double offset_sq = 0;
+    if (in >= 2 && iden > 1e-6 * axx * in) {
+        double slope = (in * axy - ax * ay) / iden;
+        offset_sq = (ay - slope * ax) / in;
+        if (offset_sq < 0) offset_sq = 0;
+    }
+    result.current_offset_a = sqrt(offset_sq);
+
+    // Each loaded step becomes a table breakpoint, exact at its own current
+    for (uint8_t s = 0; s < _count; s++) {
+        const CalibrationStep& step = _steps[s];
+        if (step.ref_current < CAL_MIN_CURRENT || step.current < CAL_MIN_CURRENT) continue;
+
+        uint8_t p = result.points++;
+        result.current[p] = step.current;
+        result.gain[p] = step.ref_current / step.current;
+
+        // Phase lead is the reference power angle minus the measured one
+        double apparent = (double)step.ref_voltage * step.ref_current;
+        if (step.ref_power >= 0 && apparent > 0 && (step.power != 0 || step.reactive != 0)) {
+            double pf = step.ref_power / apparent;
+            if (pf > 1) pf = 1;
+            double measured = atan2(step.reactive, step.power);
+            double reference = copysign(acos(pf), measured);
+            result.phase_deg[p] = (reference - measured) * 180.0 / M_PI;
+        }
+
+        // What remains is the averaging uncertainty, at ~95% confidence
+        double error = CAL_CONFIDENCE_Z * step.current_sem / step.current * 100.0;
+        if (error > result.max_current_error_pct) result.max_current_error_pct = error;
+    }
+
+    for (uint8_t s = 0; s < _count; s++) {
+        const CalibrationStep& step = _steps[s];
+        if (step.ref_voltage <= 0) continue;
+        double corrected = result.voltage_gain * step.voltage + result.voltage_offset;
+        double error = fabs(corrected - step.ref_voltage) / step.ref_voltage * 100.0;
+        if (error > result.max_voltage_error_pct) result.max_voltage_error_pct = error;
+    }
+    return true;
+}
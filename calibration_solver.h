@@ -0,0 +1,71 @@
+#ifndef CALIBRATION_SOLVER_H
+#define CALIBRATION_SOLVER_H
+
+#include <stdint.h>
+
+// Guided Calibration
+#define CAL_MAX_STEPS 8         // Reference points per session
+#define CAL_MIN_WINDOWS 20      // Windows averaged before a step may converge
+#define CAL_MAX_WINDOWS 600     // Step ends here even if not converged
+#define CAL_TARGET_REL 0.001    // Standard error of the mean current that ends a step
+#define CAL_MIN_CURRENT 0.1     // Amps below which the target is taken as absolute
+#define CAL_CONFIDENCE_Z 1.96   // Reported error bound in standard errors (~95%)
+
+// One reference point and the averaged uncorrected meter readings
+struct CalibrationStep {
+    float ref_voltage;          // Reference meter readings
+    float ref_current;
+    float ref_power;            // Negative if not given
+    float voltage;              // Mean measured values
+    float current;
+    float power;
+    float reactive;
+    float current_sem;          // Standard error of the mean current, amps
+    uint16_t windows;
+    uint32_t duration_ms;
+    bool converged;
+};
+
+struct CalibrationResult {
+    float voltage_gain;         // V = gain * measured + offset
+    float voltage_offset;
+    float current_offset_a;     // Residual quadrature offset in the readings (diagnostic)
+    uint8_t points;             // Entries in current/gain/phase_deg
+    float current[CAL_MAX_STEPS];   // Measured current of each loaded step
+    float gain[CAL_MAX_STEPS];      // Reference over measured current
+    float phase_deg[CAL_MAX_STEPS]; // CT phase lead, 0 without a power reference
+    float max_current_error_pct;    // 95% bound from averaging, over loaded steps
+    float max_voltage_error_pct;    // Fit residual over all steps
+};
+
+// Averages per-window readings against reference values, one load at a
+// time, until the mean current is known to CAL_TARGET_REL. Solves voltage
+// gain and offset (linear fit), per-load current gain and, where a
+// reference power is given, the CT phase lead from the power angle. The
+// current's quadrature offset is fitted from I^2 as a diagnostic.
+class CalibrationSolver {
+public:
+    CalibrationSolver();
+    void reset();
+    bool beginStep(float ref_voltage, float ref_current, float ref_power, uint32_t now_ms);
+    bool addWindow(float voltage, float current, float power, float reactive, uint32_t now_ms); // true when the step ends
+    void abortStep() { _running = false; }
+    bool solve(CalibrationResult& result) const;
+
+    bool isRunning() const { return _running; }
+    uint8_t getStepCount() const { return _count; }
+    const CalibrationStep& getStep(uint8_t step) const { return _steps[step < CAL_MAX_STEPS ? step : 0]; }
+
+private:
+    CalibrationStep _steps[CAL_MAX_STEPS];
+    uint8_t _count;             // Completed steps
+    bool _running;
+    uint32_t _start_ms;
+    double _sum_v;              // Running sums of the open step
+    double _sum_p;
+    double _sum_q;
+    double _mean_i;             // Welford mean and M2 of current
+    double _m2_i;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "calibration_table.h"
+#include <math.h>
+#include <string.h>
+
+#define DEG_TO_RAD_F 0.017453293f
+
+CalibrationTable::CalibrationTable() : _count(0) {
+    memset(_points, 0, sizeof(_points));
+}
+
+bool CalibrationTable::addPoint(float current_a, float gain, float phase_deg) {
+    if (current_a <= 0 || gain <= 0) return false;
+
+    uint8_t slot = 0;
+    while (slot < _count && _points[slot].current_a < current_a) slot++;
+    if (slot < _count && _points[slot].current_a == current_a) {
+        _points[slot].gain = gain;
+        _points[slot].phase_deg = phase_deg;
+        return true;
+    }
+    if (_count >= MAX_CAL_POINTS) return false;
+
+    memmove(&_points[slot + 1], &_points[slot], (_count - slot) * sizeof(CalibrationPoint));
+    _points[slot].current_a = current_a;
+    _points[slot].gain = gain;
+    _points[slot].phase_deg = phase_deg;
+    _count++;
+    return true;
+}
+
+bool CalibrationTable::setPoints(const CalibrationPoint* points, uint8_t count) {
+    clear();
+    for (uint8_t i = 0; i < count; i++) {
+        if (!addPoint(points[i].current_a, points[i].gain, points[i].phase_deg)) return false;
+    }
+    return true;
+}
+
+void CalibrationTable::lookup(float current_a, float& gain, float& phase_rad) const {
+    if (_count == 0) {
+        gain = 1.0f;
+        phase_rad = 0;
+        return;
+    }
+    if (current_a <= _points[0].current_a) {
+        gain = _points[0].gain;
+        phase_rad = _points[0].phase_deg * DEG_TO_RAD_F;
+        return;
+    }
+    if (current_a >= _points[_count - 1].current_a) {
+        gain = _points[_count - 1].gain;
+        phase_rad = _points[_count - 1].phase_deg * DEG_TO_RAD_F;
+        return;
+    }
+
+    uint8_t i = 1;
+    while (_points[i].current_a < current_a) i++;
+    const CalibrationPoint& lo = _points[i - 1];
+    const CalibrationPoint& hi = _points[i];
+    float t = logf(current_a / lo.current_a) / logf(hi.current_a / lo.current_a);
+    gain = lo.gain + t * (hi.gain - lo.gain);
+    phase_rad = (lo.phase_deg + t * (hi.phase_deg - lo.phase_deg)) * DEG_TO_RAD_F;
+}
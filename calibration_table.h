@@ -0,0 +1,34 @@
+#ifndef CALIBRATION_TABLE_H
+#define CALIBRATION_TABLE_H
+
+#include <stdint.h>
+
+#define MAX_CAL_POINTS 8        // Breakpoints per channel
+
+// Correction measured at one current magnitude
+struct CalibrationPoint {
+    float current_a;            // Uncorrected RMS current of the breakpoint
+    float gain;                 // Multiplier on current (and power)
+    float phase_deg;            // CT phase lead; current is rotated back by this
+};
+
+// Piecewise-linear gain and phase against log current, looked up once per
+// window. Outside the breakpoints the end values hold. An empty table is
+// unity gain and zero phase.
+class CalibrationTable {
+public:
+    CalibrationTable();
+    void clear() { _count = 0; }
+    bool addPoint(float current_a, float gain, float phase_deg); // Keeps points sorted
+    bool setPoints(const CalibrationPoint* points, uint8_t count);
+    void lookup(float current_a, float& gain, float& phase_rad) const;
+
+    uint8_t getCount() const { return _count; }
+    const CalibrationPoint* getPoints() const { return _points; }
+
+private:
+    CalibrationPoint _points[MAX_CAL_POINTS];
+    uint8_t _count;
+};
+
+#endif
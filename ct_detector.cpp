@@ -0,0 +1,73 @@
+#include "ct_detector.h"
+#include <math.h>
+
+CtDetector::CtDetector()
+    : _bias(CT_INITIAL_BIAS), _center(lroundf(CT_INITIAL_BIAS)),
+      _sum(0), _sum_squared(0), _sum_step_squared(0), _last_raw(0),
+      _low_rail(0), _high_rail(0), _min_raw(0), _max_raw(0), _samples(0), _mean(0), _variance(0), _step_noise(0),
+      _faults(0), _connected(true), _fault_run(0), _clean_run(0),
+      _disconnects(0) {}
+
+void CtDetector::beginWindow() {
+    _center = lroundf(_bias);
+    _sum = 0;
+    _sum_squared = 0;
+    _sum_step_squared = 0;
+    _low_rail = 0;
+    _high_rail = 0;
+    _min_raw = 4095;
+    _max_raw = 0;
+    _samples = 0;
+}
+
+uint8_t CtDetector::endWindow(float noise_variance) {
+    if (_samples < 2) return CT_NO_CHANGE;
+
+    float n = _samples;
+    float mean = _sum / n;
+    _mean = _center + mean;
+    _variance = _sum_squared / n - mean * mean;
+    if (_variance < 0) _variance = 0;
+
+    // Half the mean squared step is the white noise power; a sampled sine
+    // adds a small share of its own variance on top
+    float step_noise = _sum_step_squared / (2.0f * (n - 1));
+    _step_noise = step_noise;
+
+    _faults = 0;
+    if (fabsf(_mean - _bias) > CT_OFFSET_DRIFT + CT_DRIFT_PER_STD * sqrtf(_variance)) {
+        _faults |= CT_FAULT_DRIFT;
+    }
+    if ((_low_rail > CT_RAIL_FRACTION * n && _high_rail == 0) ||
+        (_high_rail > CT_RAIL_FRACTION * n && _low_rail == 0)) {
+        _faults |= CT_FAULT_RAIL;
+    }
+    if (_variance < CT_COLLAPSE_RATIO * noise_variance) {
+        _faults |= CT_FAULT_COLLAPSE;
+    }
+    if (step_noise > CT_OPEN_NOISE_RATIO * noise_variance + CT_SLEW_ALLOWANCE * _variance) {
+        _faults |= CT_FAULT_OPEN;
+    }
+
+    if (_connected) {
+        if (_faults == 0) {
+            _fault_run = 0;
+            _bias += CT_BIAS_RATE * (_mean - _bias);
+        } else if (++_fault_run >= CT_FAULT_WINDOWS) {
+            _connected = false;
+            _fault_run = 0;
+            _clean_run = 0;
+            _disconnects++;
+            return CT_DISCONNECTED;
+        }
+    } else {
+        if (_faults != 0) {
+            _clean_run = 0;
+        } else if (++_clean_run >= CT_CLEAR_WINDOWS) {
+            _connected = true;
+            _clean_run = 0;
+            return CT_RECONNECTED;
+        }
+    }
+    return CT_NO_CHANGE;
+}
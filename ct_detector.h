@@ -0,0 +1,91 @@
+#ifndef CT_DETECTOR_H
+#define CT_DETECTOR_H
+
+#include <stdint.h>
+
+// Disconnect Detection
+#define CT_INITIAL_BIAS 1880.0  // Channel bias assumed before the first clean window
+#define CT_BIAS_RATE 0.05       // EWMA weight of a clean window's mean in the bias
+#define CT_OFFSET_DRIFT 150.0   // Counts the window mean may move from the bias
+#define CT_DRIFT_PER_STD 1.0    // Extra drift allowed per count of signal deviation
+#define CT_RAIL_MARGIN 8        // Counts from 0 / 4095 that count as a rail
+#define CT_RAIL_FRACTION 0.5    // Share of samples pinned to one rail only
+#define CT_COLLAPSE_RATIO 0.1   // Variance below this share of the noise floor is stuck
+#define CT_OPEN_NOISE_RATIO 16.0 // Sample-to-sample noise this many times the floor is floating
+#define CT_SLEW_ALLOWANCE 0.001 // Share of window variance a sampled mains wave adds to that noise
+#define CT_FAULT_WINDOWS 2      // Consecutive faulty windows to declare a disconnect
+#define CT_CLEAR_WINDOWS 8      // Consecutive clean windows to declare a reconnect
+
+// Fault bits of one window
+#define CT_FAULT_DRIFT    0x01  // Mean left the bias (input floating or bias lost)
+#define CT_FAULT_RAIL     0x02  // Pinned to one ADC rail
+#define CT_FAULT_COLLAPSE 0x04  // Variance far below the noise floor (stuck reading)
+#define CT_FAULT_OPEN     0x08  // High-impedance input noise signature
+
+// State changes returned by endWindow()
+#define CT_NO_CHANGE    0
+#define CT_DISCONNECTED 1
+#define CT_RECONNECTED  2
+
+// Flags a missing CT from the statistics of each acquisition window
+// without extra sampling or delays. A connected CT keeps its mean on the
+// bias, does not sit on one rail, and has sample-to-sample noise near the
+// learned floor whatever the load. Windows should span at least one
+// mains cycle so that a loaded channel's mean stays on the bias.
+class CtDetector {
+public:
+    CtDetector();
+    void beginWindow();
+    void addSample(int32_t raw) {
+        int32_t centered = raw - _center;
+        int32_t step = raw - _last_raw;
+        _sum += centered;
+        _sum_squared += (int64_t)centered * centered;
+        if (_samples > 0) _sum_step_squared += (int64_t)step * step;
+        if (raw <= CT_RAIL_MARGIN) _low_rail++;
+        if (raw >= 4095 - CT_RAIL_MARGIN) _high_rail++;
+        if (raw < _min_raw) _min_raw = raw;
+        if (raw > _max_raw) _max_raw = raw;
+        _last_raw = raw;
+        _samples++;
+    }
+    uint8_t endWindow(float noise_variance);    // Returns CT_NO_CHANGE, CT_DISCONNECTED or CT_RECONNECTED
+
+    bool isConnected() const { return _connected; }
+    uint8_t getFaults() const { return _faults; }   // Last window's CT_FAULT_* bits
+    float getBias() const { return _bias; }
+    void setBias(float bias) { _bias = bias; }
+    float getRunningMean() const { return _samples > 0 ? _center + (float)_sum / _samples : _bias; }
+    float getMean() const { return _mean; }         // Last window mean, counts
+    float getVariance() const { return _variance; } // Last window variance, counts^2
+    float getStepNoise() const { return _step_noise; } // Last window's white noise power from steps, counts^2
+    uint32_t getSamples() const { return _samples; }
+    uint32_t getLowRailSamples() const { return _low_rail; }   // At or within CT_RAIL_MARGIN of 0
+    uint32_t getHighRailSamples() const { return _high_rail; } // At or within CT_RAIL_MARGIN of 4095
+    int32_t getMinRaw() const { return _min_raw; }
+    int32_t getMaxRaw() const { return _max_raw; }
+    uint32_t getDisconnects() const { return _disconnects; }
+
+private:
+    float _bias;                // Learned channel bias, counts
+    int32_t _center;            // Bias rounded for integer accumulation
+    int64_t _sum;               // Window sums about _center
+    int64_t _sum_squared;
+    int64_t _sum_step_squared;  // Sum of squared sample-to-sample steps
+    int32_t _last_raw;
+    uint32_t _low_rail;         // Samples at each rail
+    uint32_t _high_rail;
+    int32_t _min_raw;           // Window extremes
+    int32_t _max_raw;
+    uint32_t _samples;
+    float _mean;
+    float _variance;
+    float _step_noise;
+    uint8_t _faults;
+    bool _connected;
+    uint8_t _fault_run;         // Consecutive faulty windows while connected
+    uint8_t _clean_run;         // Consecutive clean windows while disconnected
+    uint32_t _disconnects;
+};
+
+#endif
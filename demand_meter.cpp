@@ -0,0 +1,96 @@
+#include "demand_meter.h"
+#include <math.h>
+
+DemandMeter::DemandMeter()
+    : _last_period_peak_w(0), _last_period_peak_time(0) {
+    configure(DEMAND_INTERVAL_S, DEMAND_SUBINTERVAL_S);
+}
+
+bool DemandMeter::configure(uint16_t interval_s, uint16_t subinterval_s) {
+    if (subinterval_s == 0 || interval_s % subinterval_s != 0 ||
+        interval_s / subinterval_s > MAX_DEMAND_SUBINTERVALS) {
+        return false;
+    }
+    _interval_s = interval_s;
+    _subinterval_s = subinterval_s;
+    _subintervals = interval_s / subinterval_s;
+    reset();
+    return true;
+}
+
+void DemandMeter::reset() {
+    for (uint8_t i = 0; i < MAX_DEMAND_SUBINTERVALS; i++) {
+        _ring_mwh[i] = 0;
+    }
+    _head = 0;
+    _filled = 0;
+    _window_mwh = 0;
+    _slot = 0;
+    _started = false;
+    _partial_wh = 0;
+    _block_demand_w = 0;
+    _rolling_demand_w = 0;
+    _peak_block_w = 0;
+    _peak_block_time = 0;
+    _peak_rolling_w = 0;
+    _peak_rolling_time = 0;
+}
+
+void DemandMeter::addEnergy(uint32_t now_s, float energy_wh) {
+    uint32_t slot = now_s / _subinterval_s;
+
+    if (!_started) {
+        _slot = slot;
+        _started = true;
+    } else if (slot != _slot) {
+        // Close the open subinterval, then zero-fill any skipped ones.
+        // A gap of a whole interval or more flushes the ring once.
+        uint32_t gap = slot - _slot;
+        if (slot < _slot || gap > _subintervals) {
+            gap = _subintervals;
+        }
+        for (uint32_t i = 0; i < gap; i++) {
+            closeSubinterval((_slot + 1) * _subinterval_s);
+            _slot++;
+        }
+        _slot = slot;
+    }
+    _partial_wh += energy_wh;
+}
+
+void DemandMeter::closeSubinterval(uint32_t end_s) {
+    // Whole mWh go into the ring; the remainder carries into the next subinterval
+    int32_t mwh = (int32_t)floorf(_partial_wh * 1000.0f);
+    _partial_wh -= mwh * 0.001f;
+
+    _window_mwh += mwh - _ring_mwh[_head];
+    _ring_mwh[_head] = mwh;
+    _head = (_head + 1) % _subintervals;
+    if (_filled < _subintervals) _filled++;
+    if (_filled < _subintervals) return;
+
+    float demand_w = _window_mwh * 0.001f * SECONDS_PER_HOUR / _interval_s;
+
+    _rolling_demand_w = demand_w;
+    if (demand_w > _peak_rolling_w) {
+        _peak_rolling_w = demand_w;
+        _peak_rolling_time = end_s;
+    }
+
+    if (end_s % _interval_s == 0) {
+        _block_demand_w = demand_w;
+        if (demand_w > _peak_block_w) {
+            _peak_block_w = demand_w;
+            _peak_block_time = end_s;
+        }
+    }
+}
+
+void DemandMeter::startBillingPeriod() {
+    _last_period_peak_w = _peak_block_w;
+    _last_period_peak_time = _peak_block_time;
+    _peak_block_w = 0;
+    _peak_block_time = 0;
+    _peak_rolling_w = 0;
+    _peak_rolling_time = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef DEMAND_METER_H
+#define DEMAND_METER_H
+
+#include <stdint.h>
+
+// Demand Configuration
+#define DEMAND_INTERVAL_S 900        // 15 minute demand interval
+#define DEMAND_SUBINTERVAL_S 60      // Rolling demand step
+#define MAX_DEMAND_SUBINTERVALS 60   // Ring size, bounds interval / subinterval
+#define SECONDS_PER_HOUR 3600
+
+// Block and rolling (sliding window) demand with peak tracking.
+// Energy is summed per subinterval into a fixed ring of integer mWh so
+// the window sum is updated exactly with one add and one subtract.
+class DemandMeter {
+public:
+    DemandMeter();
+    bool configure(uint16_t interval_s, uint16_t subinterval_s); // False if not a whole multiple or ring too small
+    void addEnergy(uint32_t now_s, float energy_wh);
+    void startBillingPeriod();  // Keep last period peaks and start a new one
+
+    float getBlockDemandW() const { return _block_demand_w; }     // Last completed aligned interval
+    float getRollingDemandW() const { return _rolling_demand_w; } // Last full sliding window
+    float getPeakBlockDemandW() const { return _peak_block_w; }
+    uint32_t getPeakBlockTime() const { return _peak_block_time; }
+    float getPeakRollingDemandW() const { return _peak_rolling_w; }
+    uint32_t getPeakRollingTime() const { return _peak_rolling_time; }
+    float getLastPeriodPeakW() const { return _last_period_peak_w; }
+    uint32_t getLastPeriodPeakTime() const { return _last_period_peak_time; }
+    uint16_t getIntervalSeconds() const { return _interval_s; }
+    uint16_t getSubintervalSeconds() const { return _subinterval_s; }
+
+private:
+    uint16_t _interval_s;       // Demand interval length
+    uint16_t _subinterval_s;    // Subinterval length
+    uint8_t _subintervals;      // Subintervals per interval
+    int32_t _ring_mwh[MAX_DEMAND_SUBINTERVALS]; // Closed subinterval energy
+    uint8_t _head;              // Next ring slot to overwrite
+    uint8_t _filled;            // Valid slots in the ring
+    int64_t _window_mwh;        // Sum of the ring
+    uint32_t _slot;             // Current subinterval number (now / subinterval)
+    bool _started;              // _slot is valid
+    float _partial_wh;          // Energy of the open subinterval
+    float _block_demand_w;
+    float _rolling_demand_w;
+    float _peak_block_w;
+    uint32_t _peak_block_time;
+    float _peak_rolling_w;
+    uint32_t _peak_rolling_time;
+    float _last_period_peak_w;
+    uint32_t _last_period_peak_time;
+
+    void reset();
+    void closeSubinterval(uint32_t end_s);
+};
+
+#endif
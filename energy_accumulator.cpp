@@ -0,0 +1,10 @@
+#include "energy_accumulator.h"
+#include <math.h>
+
+void EnergyAccumulator::add(float power_w, uint32_t elapsed_ms) {
+    // mW x ms = uJ; integer from here on
+    int64_t uj = (int64_t)lroundf(power_w * 1000.0f) * elapsed_ms + _uj_remainder;
+    int64_t mj = uj / UJ_PER_MJ;
+    _uj_remainder = (int32_t)(uj - mj * UJ_PER_MJ);
+    _mj += mj;
+}
@@ -0,0 +1,28 @@
+#ifndef ENERGY_ACCUMULATOR_H
+#define ENERGY_ACCUMULATOR_H
+
+#include <stdint.h>
+
+#define MJ_PER_KWH 3600000000.0 // Milli-joules per kilowatt-hour
+#define UJ_PER_MJ 1000
+
+// Exact energy register: whole milli-joules in 64 bits plus a carried
+// micro-joule remainder, so no increment is ever rounded away. At 1 MW the
+// register lasts ~290,000 years.
+class EnergyAccumulator {
+public:
+    EnergyAccumulator() : _mj(0), _uj_remainder(0) {}
+    void add(float power_w, uint32_t elapsed_ms);   // Power held over elapsed time
+    void addMilliJoules(int64_t mj) { _mj += mj; }
+    void reset() { _mj = 0; _uj_remainder = 0; }
+
+    int64_t getMilliJoules() const { return _mj; }
+    double getKWh() const { return _mj / MJ_PER_KWH; }
+    double getWh() const { return _mj / (MJ_PER_KWH / 1000.0); }
+
+private:
+    int64_t _mj;                // Whole milli-joules
+    int32_t _uj_remainder;      // Carried micro-joules, |remainder| < 1000
+};
+
+#endif
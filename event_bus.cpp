@@ -0,0 +1,112 @@
+#include "event_bus.h"
+
+EventQueue::EventQueue() : _enqueue(0), _dequeue(0) {
+    for (uint32_t i = 0; i < EVENT_QUEUE_SIZE; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+// A slot is free for position p when its sequence equals p, and holds an
+// event for the consumer when it equals p + 1
+bool EventQueue::push(const Event& event) {
+    uint32_t pos = _enqueue.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = _slots[pos & (EVENT_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.event = event;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;       // Full
+        } else {
+            pos = _enqueue.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool EventQueue::pop(Event& event) {
+    uint32_t pos = _dequeue.load(std::memory_order_relaxed);
+    Slot& slot = _slots[pos & (EVENT_QUEUE_SIZE - 1)];
+    if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (pos + 1)) < 0) {
+        return false;           // Empty, or the claiming publisher is still copying
+    }
+    event = slot.event;
+    slot.sequence.store(pos + EVENT_QUEUE_SIZE, std::memory_order_release);
+    _dequeue.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+uint8_t EventQueue::getDepth() const {
+    return _enqueue.load(std::memory_order_relaxed) - _dequeue.load(std::memory_order_relaxed);
+}
+
+EventBus::EventBus() : _count(0) {
+    for (uint8_t s = 0; s < EVENT_MAX_SUBSCRIBERS; s++) {
+        _subscribers[s].mask = 0;
+        _subscribers[s].wake = 0;
+        _subscribers[s].context = 0;
+        _subscribers[s].delivered.store(0, std::memory_order_relaxed);
+        _subscribers[s].dropped.store(0, std::memory_order_relaxed);
+        _subscribers[s].max_depth.store(0, std::memory_order_relaxed);
+    }
+    for (uint8_t t = 0; t < EVENT_TYPES; t++) {
+        _published[t].store(0, std::memory_order_relaxed);
+    }
+}
+
+int8_t EventBus::subscribe(uint32_t type_mask, WakeHook wake, void* context) {
+    if (_count >= EVENT_MAX_SUBSCRIBERS) return -1;
+    Subscriber& s = _subscribers[_count];
+    s.mask = type_mask;
+    s.wake = wake;
+    s.context = context;
+    return _count++;
+}
+
+uint8_t EventBus::publish(Event& event, uint32_t now_ms) {
+    if (event.type >= EVENT_TYPES) return 0;
+    event.time_ms = now_ms;
+    _published[event.type].fetch_add(1, std::memory_order_relaxed);
+
+    uint8_t missed = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        Subscriber& s = _subscribers[i];
+        if (!(s.mask & EVENT_BIT(event.type))) continue;
+
+        if (!s.queue.push(event)) {
+            s.dropped.fetch_add(1, std::memory_order_relaxed);
+            missed++;
+            continue;
+        }
+        s.delivered.fetch_add(1, std::memory_order_relaxed);
+        uint8_t depth = s.queue.getDepth();
+        uint8_t seen = s.max_depth.load(std::memory_order_relaxed);
+        while (depth > seen && !s.max_depth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+        if (s.wake) s.wake(s.context);
+    }
+    return missed;
+}
+
+bool EventBus::poll(uint8_t subscriber, Event& event) {
+    if (subscriber >= _count) return false;
+    return _subscribers[subscriber].queue.pop(event);
+}
+
+uint32_t EventBus::getPublished(uint8_t type) const {
+    return type < EVENT_TYPES ? _published[type].load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t EventBus::getDelivered(uint8_t subscriber) const {
+    return subscriber < _count ? _subscribers[subscriber].delivered.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t EventBus::getDropped(uint8_t subscriber) const {
+    return subscriber < _count ? _subscribers[subscriber].dropped.load(std::memory_order_relaxed) : 0;
+}
+
+uint8_t EventBus::getMaxDepth(uint8_t subscriber) const {
+    return subscriber < _count ? _subscribers[subscriber].max_depth.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,105 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <atomic>
+#include "measurement_snapshot.h"
+#include "load_events.h"
+#include "anomaly_detector.h"
+
+// Event Bus
+#define EVENT_MAX_SUBSCRIBERS 4
+#define EVENT_QUEUE_SIZE 16     // Events per subscriber, power of two
+
+// Event types; subscribers pass a mask of EVENT_BIT(type)
+#define EVENT_WINDOW  0         // Measurement of a finished window
+#define EVENT_BUTTON  1         // ButtonAction
+#define EVENT_LOAD    2         // LoadEvent from the step detector
+#define EVENT_ANOMALY 3         // AnomalyEvent
+#define EVENT_CONFIG  4         // ConfigChange
+#define EVENT_TYPES   5
+#define EVENT_BIT(type) (1u << (type))
+
+// Button actions
+#define BUTTON_PRESS 0
+#define BUTTON_LONG  1
+
+struct ButtonAction {
+    uint8_t button;             // Button id, e.g. its pin
+    uint8_t action;             // BUTTON_PRESS or BUTTON_LONG
+};
+
+struct ConfigChange {
+    uint8_t phase_count;        // SINGLE_PHASE or THREE_PHASE
+    uint8_t source;             // Sketch-defined origin (button, serial, boot)
+};
+
+struct Event {
+    uint8_t type;               // EVENT_*
+    uint32_t time_ms;           // Publisher's clock, set by publish()
+    union {
+        Measurement window;
+        ButtonAction button;
+        LoadEvent load;
+        AnomalyEvent anomaly;
+        ConfigChange config;
+    };
+};
+
+// Bounded multi-producer, single-consumer queue (per-slot sequence
+// numbers). Publishers on any task claim a slot with one CAS and never
+// wait; a full queue refuses the event.
+class EventQueue {
+public:
+    EventQueue();
+    bool push(const Event& event);
+    bool pop(Event& event);     // Consumer only
+    uint8_t getDepth() const;
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        Event event;
+    };
+    Slot _slots[EVENT_QUEUE_SIZE];
+    std::atomic<uint32_t> _enqueue;
+    std::atomic<uint32_t> _dequeue;
+};
+
+// Typed publish/subscribe between tasks. Each subscriber has its own
+// fixed queue, so a slow consumer only loses its own events; drops and
+// the deepest backlog are counted per subscriber. Subscribe during
+// startup; publish() and poll() are safe from any task afterwards and
+// never allocate. An optional wake hook runs after each delivery, e.g. to
+// notify the consuming task.
+class EventBus {
+public:
+    typedef void (*WakeHook)(void* context);
+
+    EventBus();
+    int8_t subscribe(uint32_t type_mask, WakeHook wake = 0, void* context = 0); // -1 when full
+    uint8_t publish(Event& event, uint32_t now_ms); // Stamps time_ms; returns subscribers that missed it
+    bool poll(uint8_t subscriber, Event& event);
+
+    uint8_t getSubscriberCount() const { return _count; }
+    uint32_t getPublished(uint8_t type) const;
+    uint32_t getDelivered(uint8_t subscriber) const;
+    uint32_t getDropped(uint8_t subscriber) const;  // Refused because the queue was full
+    uint8_t getMaxDepth(uint8_t subscriber) const;  // Deepest backlog seen
+
+private:
+    struct Subscriber {
+        uint32_t mask;
+        WakeHook wake;
+        void* context;
+        EventQueue queue;
+        std::atomic<uint32_t> delivered;
+        std::atomic<uint32_t> dropped;
+        std::atomic<uint8_t> max_depth;
+    };
+    Subscriber _subscribers[EVENT_MAX_SUBSCRIBERS];
+    uint8_t _count;
+    std::atomic<uint32_t> _published[EVENT_TYPES];
+};
+
+#endif
@@ -9,12 +9,52 @@
 #include <freertos/semphr.h>
 #include <EEPROM.h>
 #include "button.h"
+#include "task_stats.h"
+#include "spsc_ring.h"
+#include "event_bus.h"
+#include "stage_timing.h"
+#include <esp_task_wdt.h>
+#include <atomic>
 
 // Pin Definitions
 #define CURRENT_PIN 36  // ADC1_CH0 (GPIO 36/VP/A0)
 #define VOLTAGE_PIN 39  // ADC1_CH3 (GPIO 39/VN/A3)
 #define SD_CS_PIN  5    // SD Card CS pin
 
+// Three-phase CT pins (phase A shares CURRENT_PIN)
+#define CURRENT_PIN_B 34  // ADC1_CH6 (GPIO 34)
+#define CURRENT_PIN_C 35  // ADC1_CH7 (GPIO 35)
+const uint8_t THREE_PHASE_CURRENT_PINS[PHASES] = {CURRENT_PIN, CURRENT_PIN_B, CURRENT_PIN_C};
+const uint8_t THREE_PHASE_VOLTAGE_PINS[PHASES] = {VOLTAGE_PIN, NO_PIN, NO_PIN};  // B/C derived from A
+
+// Single-phase current gain ranges. The 1.5V CT bias only fits the 11 dB
+// and 6 dB spans; an amplified copy of the CT signal on HIGH_GAIN_PIN adds
+// a finer range for standby loads. Calibrate each range's gain against
+// the 11 dB reading.
+#define RANGE_6DB_GAIN   1.5    // 11 dB span over 6 dB span
+#define RANGE_6DB_BIAS   2820   // CT bias in 6 dB counts (learned on first use)
+#define HIGH_GAIN_PIN    NO_PIN // e.g. 32 with a x10 op-amp stage
+#define HIGH_GAIN        15.0   // Amplifier gain times RANGE_6DB_GAIN
+#define HIGH_GAIN_BIAS   2048
+
+// CT calibration against current, pasted from tools/fit_calibration. A
+// single unity point leaves ICAL alone; tables saved in NVS take precedence.
+const CalibrationPoint CURRENT_CAL_A[] = {{1.0, 1.0, 0.0}};
+const CalibrationPoint CURRENT_CAL_B[] = {{1.0, 1.0, 0.0}};
+const CalibrationPoint CURRENT_CAL_C[] = {{1.0, 1.0, 0.0}};
+
+// Guided calibration over serial, one line per command:
+//   cal <a|b|c> <volts> <amps> [watts]   average one reference load
+//   cal solve | cal clear | cal abort
+// Run a no-load step and two or more loads spanning the CT range, then
+// solve; the result is composed onto the active tables and saved to NVS.
+#define SERIAL_LINE_MAX 64
+
+// SD log columns, one row per minute; forecast columns are empty until
+// the forecaster has a day of data
+#define LOG_HEADER "Timestamp,Voltage(V),Current(A),Power(W),Energy(kWh),Demand(W),PeakDemand(W)," \
+                   "NextHour(Wh),NextHourBand(Wh),EndOfDay(kWh),EndOfDayBand(kWh)"
+
 // Button Pins
 #define BTN_LEFT   27
 #define BTN_RIGHT  26
@@ -25,12 +65,74 @@
 #define DISPLAY_VI    0   // Voltage and Current
 #define DISPLAY_PE    1   // Power and Energy
 #define DISPLAY_SET   2   // Settings
-
-// Task handle for UI task
+#define DISPLAY_FC    3   // Next-hour and end-of-day forecast
+
+// Tasks: acquisition/DSP owns PowerMonitor on core 0; UI, logging and
+// loop() stay on core 1 so LCD I2C and SD writes never delay a window
+#define ACQ_PERIOD_MS  100    // One window per period
+#define ACQ_PRIORITY   3      // Above UI and loop()
+#define ACQ_CORE       0
+#define LOOP_PERIOD_MS 10
+
+// UITask sleeps until a button edge or a bus event wakes it, polling only
+// while a button is debouncing or held. Window and config redraws can be
+// capped; button redraws are never delayed.
+#define UI_MIN_REDRAW_MS 0    // Shortest gap between window redraws, 0 for none
+#define UI_WAKE_BUTTON   0x01 // Notification bits
+#define UI_WAKE_EVENT    0x02
+
+// Task watchdog: AcqTask, DspTask and loop() feed it on every wake-up and
+// their longest gap between feeds is reported. UITask may sleep for as
+// long as nothing happens, so it is not watched.
+#define WDT_TIMEOUT_S    5
+
+// Split mode (single-phase): AcqTask only samples frames back to back into
+// frameRing, and DspTask on core 1 turns them into readings, so sampling
+// carries on while a window is computed. Three-phase windows run in
+// DspTask as one update() per ACQ_PERIOD_MS.
+#define SPLIT_DSP       0
+#define FRAME_RING_SIZE 4     // Frames in flight, ~3 KB each
+#define DSP_PRIORITY    2
+#define DSP_CORE        1
+
+// Task handles
 TaskHandle_t UITask;
-
-// Mutex for display access
-SemaphoreHandle_t displayMutex;
+TaskHandle_t AcqTask;
+TaskHandle_t DspTask;
+
+// Held by the acquisition task for each update(); core 1 code takes it
+// before changing the monitor or reading its attached modules
+SemaphoreHandle_t monitorMutex;
+
+struct MonitorLock {
+    MonitorLock() { xSemaphoreTake(monitorMutex, portMAX_DELAY); }
+    ~MonitorLock() { xSemaphoreGive(monitorMutex); }
+};
+
+// What AcqTask samples next in split mode; set by the monitor's owner
+std::atomic<uint32_t> samplePlan(NO_PIN);
+
+#if SPLIT_DSP
+SpscRing<SampleFrame, FRAME_RING_SIZE> frameRing;
+#endif
+
+// CPU load and wake-up latency per task, printed with each log entry
+#if SPLIT_DSP
+TaskStats acqStats(portTICK_PERIOD_MS * 1000UL, false);
+TaskStats dspStats(ACQ_PERIOD_MS * 1000UL, false);
+#else
+TaskStats acqStats(ACQ_PERIOD_MS * 1000UL, true);
+#endif
+TaskStats uiStats(0, false);    // Event-driven: load only
+
+// UI wake-ups and button-to-LCD latency, printed with the task stats
+std::atomic<uint32_t> buttonEdgeUs(0);  // First unhandled edge, 0 for none
+uint32_t uiWakeups = 0;                 // Since boot
+uint32_t uiIdleWakeups = 0;             // Wake-ups that drew nothing
+uint32_t lastButtonLcdUs = 0;           // Edge to finished redraw
+uint32_t worstButtonLcdUs = 0;
+TaskStats loopStats(LOOP_PERIOD_MS * 1000UL, false);
+StageTiming stageTiming;    // Acquire/DSP/energy/log/display durations since boot
 
 // EEPROM Configuration
 #define EEPROM_SIZE 64        // Size of EEPROM in bytes
@@ -40,10 +142,40 @@ SemaphoreHandle_t displayMutex;
 
 // Create objects
 PowerMonitor powerMonitor(CURRENT_PIN, VOLTAGE_PIN, SINGLE_PHASE);
+RollupStore rollups;  // 1 s / 1 min / 15 min / 1 h / 1 day history in RAM
+DailyPercentiles percentiles;  // P50/P95/P99 current and power per day
+LoadEventDetector loadEvents;  // Appliance on/off events from power steps
+AnomalyDetector anomalies;     // Abnormal V/I/P and base-load creep
+EnergyForecaster forecaster;   // Next hour and end-of-day energy
+TariffEngine tariff;           // Time-of-use energy and cost per band
+MeasurementSnapshot snapshot;  // Last window's readings for UI and logging
+EventBus bus;                  // Windows, buttons, load/anomaly events, config changes
 LiquidCrystal_I2C lcd(0x27, 16, 2);  // Most common address for LCD
 RTC_DS3231 rtc;
 String currentFileName;
 
+// Copies taken under the monitor lock so logPowerData() prints without it;
+// copy() needs the lock, print() must not hold it
+struct TariffReport {
+    uint8_t current;
+    uint8_t bands;
+    double kwh[MAX_TARIFF_BANDS];
+    double cost[MAX_TARIFF_BANDS];
+    double total_cost;
+
+    void copy();
+    void print() const;
+};
+
+struct PercentileReport {
+    bool valid;
+    float current[3];  // Yesterday's P50/P95/P99, A
+    float power[3];    // W
+
+    void copy();
+    void print() const;
+};
+
 // Button initialization
 Button btnLeft(BTN_LEFT);
 Button btnRight(BTN_RIGHT);
@@ -54,28 +186,178 @@ Button btnSelect(BTN_SELECT);
 uint8_t displayMode = DISPLAY_VI;
 bool inSettings = false;
 bool phaseSettingSelected = false;
-volatile bool displayNeedsUpdate = false;
+
+// Bus subscribers, set in setup() before the tasks start
+int8_t displaySub = -1;  // UI task: windows, buttons, config changes
+int8_t loggerSub = -1;   // loop(): load/anomaly events, config changes
+
+// Origin of a ConfigChange
+#define CONFIG_FROM_BUTTON 0
+#define CONFIG_FROM_BOOT   1
+
+// Button edges, from either direction; debouncing is left to the task
+void IRAM_ATTR buttonEdgeISR() {
+    if (buttonEdgeUs.load(std::memory_order_relaxed) == 0) {
+        buttonEdgeUs.store(micros() | 1, std::memory_order_relaxed);
+    }
+    BaseType_t woken = pdFALSE;
+    if (UITask) {
+        xTaskNotifyFromISR(UITask, UI_WAKE_BUTTON, eSetBits, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+// Bus wake hook for the display subscriber
+void notifyUI(void* context) {
+    if (UITask && xTaskGetCurrentTaskHandle() != UITask) {
+        xTaskNotify(UITask, UI_WAKE_EVENT, eSetBits);
+    }
+}
 
 // UI Task running on Core 1
 void UITaskCode(void * parameter) {
     Serial.println("UI Task starting on core " + String(xPortGetCoreID()));
+    uint32_t waitMs = 0;            // Poll the buttons once at start
+    uint32_t lastRedrawMs = 0;
+    bool redrawPending = false;
 
     for(;;) {
-        // Handle buttons and update display if needed
-        bool buttonsChanged = handleButtons();
-
-        if (displayNeedsUpdate || buttonsChanged) {
-            if (xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                updateDisplay();
-                displayNeedsUpdate = false;
-                xSemaphoreGive(displayMutex);
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UI_WAKE_BUTTON | UI_WAKE_EVENT, &bits,
+                        waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+        uiStats.begin(micros());
+        uiWakeups++;
+
+        // Buttons go through the bus like every other input; redraw on
+        // input, a new window or a config change. Only this task drives
+        // the LCD.
+        waitMs = pollButtons();
+        bool buttonRedraw = false;
+        bool busy = false;
+        Event event;
+        while (bus.poll(displaySub, event)) {
+            busy = true;
+            if (event.type == EVENT_BUTTON) {
+                buttonRedraw |= handleButton(event.button);
+            } else {
+                redrawPending = true;
             }
         }
 
-        // Regular yield
-        vTaskDelay(pdMS_TO_TICKS(10));
+        uint32_t now = millis();
+        uint32_t sinceRedraw = now - lastRedrawMs;
+        if (buttonRedraw || (redrawPending && sinceRedraw >= UI_MIN_REDRAW_MS)) {
+            uint32_t drawStart = micros();
+            updateDisplay();
+            stageTiming.record(STAGE_DISPLAY, micros() - drawStart);
+            lastRedrawMs = now;
+            redrawPending = false;
+        } else if (redrawPending) {
+            waitMs = min(waitMs, UI_MIN_REDRAW_MS - sinceRedraw);
+        }
+
+        // Edges that produced no press (releases, bounces) are dropped
+        // once the buttons settle
+        if (buttonRedraw || waitMs == UINT32_MAX) {
+            uint32_t edge = buttonEdgeUs.exchange(0, std::memory_order_relaxed);
+            if (buttonRedraw && edge) {
+                lastButtonLcdUs = micros() - edge;
+                if (lastButtonLcdUs > worstButtonLcdUs) worstButtonLcdUs = lastButtonLcdUs;
+            }
+        }
+        if (!busy && !buttonRedraw) {
+            uiIdleWakeups++;
+        }
+
+        uiStats.end(micros());
+    }
+}
+
+// Call with the monitor locked after anything that changes its inputs
+void publishSamplePlan() {
+    samplePlan.store(powerMonitor.getSamplePlan().pack());
+}
+
+#if SPLIT_DSP
+// Sampling Task running on Core 0, never touches the monitor
+void AcqTaskCode(void * parameter) {
+    Serial.println("Sampling Task starting on core " + String(xPortGetCoreID()));
+
+    esp_task_wdt_add(NULL);
+    uint32_t sequence = 0;
+    for(;;) {
+        // One tick between frames lets IDLE0 feed the task watchdog
+        vTaskDelay(1);
+        esp_task_wdt_reset();
+        SamplePlan plan = SamplePlan::unpack(samplePlan.load());
+        if (plan.current_pin == NO_PIN) {
+            continue;   // Three-phase: DspTask samples
+        }
+        SampleFrame* frame = frameRing.beginWrite();
+        if (!frame) {
+            continue;   // DSP behind; counted as an overrun
+        }
+        acqStats.begin(micros());
+        frame->sequence = sequence++;
+        PowerMonitor::acquireFrame(plan, *frame);
+        stageTiming.record(STAGE_ACQUIRE, frame->duration_us);
+        frameRing.endWrite();
+        acqStats.end(micros());
+        xTaskNotifyGive(DspTask);
+    }
+}
+
+// DSP Task running on Core 1, owns the monitor
+void DspTaskCode(void * parameter) {
+    Serial.println("DSP Task starting on core " + String(xPortGetCoreID()));
+
+    esp_task_wdt_add(NULL);
+    for(;;) {
+        esp_task_wdt_reset();
+        // The published plan has no single-phase pin in three-phase mode
+        if (SamplePlan::unpack(samplePlan.load()).current_pin == NO_PIN) {
+            vTaskDelay(pdMS_TO_TICKS(ACQ_PERIOD_MS));
+            dspStats.begin(micros());
+            MonitorLock lock;
+            powerMonitor.update();
+            publishSamplePlan();
+            dspStats.end(micros());
+            continue;
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACQ_PERIOD_MS));
+        const SampleFrame* frame;
+        while ((frame = frameRing.beginRead()) != NULL) {
+            dspStats.begin(micros());
+            {
+                MonitorLock lock;
+                powerMonitor.processFrame(*frame);
+                publishSamplePlan();
+            }
+            frameRing.endRead();
+            dspStats.end(micros());
+        }
+    }
+}
+#else
+// Acquisition Task running on Core 0, one window per ACQ_PERIOD_MS
+void AcqTaskCode(void * parameter) {
+    Serial.println("Acquisition Task starting on core " + String(xPortGetCoreID()));
+
+    esp_task_wdt_add(NULL);
+    TickType_t wake = xTaskGetTickCount();
+    for(;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(ACQ_PERIOD_MS));
+        esp_task_wdt_reset();
+        acqStats.begin(micros());
+        {
+            MonitorLock lock;
+            powerMonitor.update();
+        }
+        acqStats.end(micros());
     }
 }
+#endif
 
 void setup() {
     Serial.begin(115200);
@@ -129,16 +411,44 @@ void setup() {
     if (!SD.exists(currentFileName)) {
         File dataFile = SD.open(currentFileName, FILE_WRITE);
         if (dataFile) {
-            dataFile.println("Timestamp,Voltage(V),Current(A),Power(W),Energy(kWh)");
+            dataFile.println(LOG_HEADER);
             dataFile.close();
         }
     }
 
     // Initialize power monitor
+    powerMonitor.setRollupStore(&rollups);
+    powerMonitor.setPercentiles(&percentiles);
+    powerMonitor.setLoadEventDetector(&loadEvents);
+    powerMonitor.setAnomalyDetector(&anomalies);
+    powerMonitor.setForecaster(&forecaster);
+    powerMonitor.setTariff(&tariff);
+    powerMonitor.setSnapshot(&snapshot);
+    powerMonitor.setEventBus(&bus);
+    powerMonitor.setStageTiming(&stageTiming);
+    configureInputs(powerMonitor);
     powerMonitor.begin();
 
-    // Create mutex for display access
-    displayMutex = xSemaphoreCreateMutex();
+    // Known appliance steps (W, var) for sub-metering without extra CTs
+    loadEvents.addSignature("Kettle", 2000, 0);
+    loadEvents.addSignature("Fridge", 120, 90);
+    loadEvents.addSignature("Microwave", 1200, 350);
+    loadEvents.addSignature("Heater", 1500, 0);
+    setupTariff();
+    powerMonitor.syncClock(rtc.now().unixtime());
+
+    // Create mutex for monitor access
+    monitorMutex = xSemaphoreCreateMutex();
+
+    // Watch loop() (this task) as well as the acquisition tasks
+    esp_task_wdt_init(WDT_TIMEOUT_S, true);
+    esp_task_wdt_add(NULL);
+
+    // Subscribe before any task publishes
+    displaySub = bus.subscribe(EVENT_BIT(EVENT_WINDOW) | EVENT_BIT(EVENT_BUTTON) | EVENT_BIT(EVENT_CONFIG),
+                               notifyUI);
+    loggerSub = bus.subscribe(EVENT_BIT(EVENT_LOAD) | EVENT_BIT(EVENT_ANOMALY) | EVENT_BIT(EVENT_CONFIG));
+    publishConfigChange(CONFIG_FROM_BOOT);
 
     // Initialize buttons
     btnLeft.begin();
@@ -157,90 +467,257 @@ void setup() {
         1  // Run on Core 1
     );
 
+    // Wake the UI task on button edges instead of polling
+    attachInterrupt(digitalPinToInterrupt(BTN_LEFT), buttonEdgeISR, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(BTN_RIGHT), buttonEdgeISR, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(BTN_BACK), buttonEdgeISR, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(BTN_SELECT), buttonEdgeISR, CHANGE);
+
+    publishSamplePlan();
+#if SPLIT_DSP
+    // Create DSP task on Core 1 before the sampler that notifies it
+    xTaskCreatePinnedToCore(
+        DspTaskCode,
+        "DspTask",
+        8192,
+        NULL,
+        DSP_PRIORITY,
+        &DspTask,
+        DSP_CORE
+    );
+#endif
+
+    // Create acquisition task on Core 0
+    xTaskCreatePinnedToCore(
+        AcqTaskCode,
+        "AcqTask",
+        8192,
+        NULL,
+        ACQ_PRIORITY,
+        &AcqTask,
+        ACQ_CORE
+    );
+
     lcd.clear();
     lcd.print("Monitor Ready");
     delay(1000);
 }
 
 void loop() {
-    static unsigned long last_power_update = 0;
     static unsigned long last_log_update = 0;
     unsigned long current_time = millis();
-
-    // Update power monitor readings every 100ms
-    if (current_time - last_power_update >= 100) {
-        powerMonitor.update();
-        last_power_update = current_time;
-
-        // Trigger display update
-        if (xSemaphoreTake(displayMutex, 0) == pdTRUE) {
-            displayNeedsUpdate = true;
-            xSemaphoreGive(displayMutex);
+    esp_task_wdt_reset();
+    loopStats.begin(micros());
+
+    // Events arrive by value from the acquisition task; no lock needed
+    Event event;
+    while (bus.poll(loggerSub, event)) {
+        if (event.type == EVENT_LOAD) {
+            printLoadEvent(event.load);
+        } else if (event.type == EVENT_ANOMALY) {
+            printAnomalyEvent(event.anomaly);
+        } else if (event.type == EVENT_CONFIG) {
+            Serial.print("Phase mode: ");
+            Serial.println(event.config.phase_count == THREE_PHASE ? "Three Phase" : "Single Phase");
         }
     }
 
+    handleSerial();
+
     // Log data every minute
     if (current_time - last_log_update >= 60000) {
+        uint32_t logStart = micros();
         logPowerData();
+        stageTiming.record(STAGE_LOG, micros() - logStart);
+        printTaskStats();
         last_log_update = current_time;
     }
 
+    loopStats.end(micros());
+
     // Small delay to prevent watchdog issues
-    delay(10);
+    delay(LOOP_PERIOD_MS);
 }
 
+void printTaskStats() {
+    struct Row { const char* name; TaskStats* stats; };
+#if SPLIT_DSP
+    const Row rows[] = {{"Acq", &acqStats}, {"DSP", &dspStats}, {"UI", &uiStats}, {"Loop", &loopStats}};
+    Serial.print("Frames: "); Serial.print(frameRing.getWritten());
+    Serial.print(" sampled, "); Serial.print(frameRing.getOverruns());
+    Serial.println(" overruns");
+#else
+    const Row rows[] = {{"Acq", &acqStats}, {"UI", &uiStats}, {"Loop", &loopStats}};
+#endif
+    for (const Row& row : rows) {
+        Serial.print("Task "); Serial.print(row.name);
+        Serial.print(": load "); Serial.print(row.stats->getLoadPct(), 1);
+        Serial.print("%, max busy "); Serial.print(row.stats->getMaxBusyUs() / 1000.0, 1);
+        Serial.print("ms");
+        if (row.stats->isPeriodic()) {
+            Serial.print(", worst latency "); Serial.print(row.stats->getWorstLatencyUs() / 1000.0, 1);
+            Serial.print("ms");
+        }
+        Serial.println();
+        row.stats->requestReset();
+    }
 
-bool handleButtons() {
-    bool displayNeedsUpdate = false;
+    Serial.print("UI wake-ups: "); Serial.print(uiWakeups);
+    Serial.print(", idle "); Serial.print(uiIdleWakeups);
+    Serial.print(", button to LCD last "); Serial.print(lastButtonLcdUs / 1000.0, 1);
+    Serial.print("ms, worst "); Serial.print(worstButtonLcdUs / 1000.0, 1);
+    Serial.println("ms");
+
+    const char* const subscribers[] = {"display", "logger"};
+    for (uint8_t s = 0; s < bus.getSubscriberCount(); s++) {
+        Serial.print("Bus "); Serial.print(subscribers[s]);
+        Serial.print(": "); Serial.print(bus.getDelivered(s));
+        Serial.print(" delivered, "); Serial.print(bus.getDropped(s));
+        Serial.print(" dropped, max depth "); Serial.println(bus.getMaxDepth(s));
+    }
+}
 
-    // Update all buttons
-    btnLeft.update();
-    btnRight.update();
-    btnBack.update();
-    btnSelect.update();
+// Since-boot figures for the "timing" serial command. Everything read here
+// is a 32-bit word written by its owning task, so no lock is taken.
+void printTimingReport() {
+    for (uint8_t stage = 0; stage < STAGES; stage++) {
+        Serial.print("Stage "); Serial.print(StageTiming::getName(stage));
+        Serial.print(": "); Serial.print(stageTiming.getCount(stage));
+        Serial.print(" runs, last "); Serial.print(stageTiming.getLastUs(stage) / 1000.0, 2);
+        Serial.print("ms, mean "); Serial.print(stageTiming.getMeanUs(stage) / 1000.0, 2);
+        Serial.print("ms, max "); Serial.print(stageTiming.getMaxUs(stage) / 1000.0, 2);
+        Serial.println("ms");
+    }
+
+    struct Row { const char* name; TaskStats* stats; bool watched; };
+#if SPLIT_DSP
+    const Row rows[] = {{"Acq", &acqStats, true}, {"DSP", &dspStats, true},
+                        {"UI", &uiStats, false}, {"Loop", &loopStats, true}};
+#else
+    const Row rows[] = {{"Acq", &acqStats, true}, {"UI", &uiStats, false}, {"Loop", &loopStats, true}};
+#endif
+    for (const Row& row : rows) {
+        Serial.print("Task "); Serial.print(row.name);
+        if (row.stats->isPeriodic()) {
+            Serial.print(": max latency "); Serial.print(row.stats->getMaxLatencyUs() / 1000.0, 2);
+            Serial.print("ms, lateness");
+            for (uint8_t b = 0; b < LATENESS_BUCKETS; b++) {
+                uint32_t limit = TaskStats::getLatenessLimitUs(b);
+                Serial.print(" ");
+                if (limit == UINT32_MAX) {
+                    Serial.print(">");
+                    Serial.print(TaskStats::getLatenessLimitUs(b - 1) / 1000.0, 1);
+                } else {
+                    Serial.print("<");
+                    Serial.print(limit / 1000.0, 1);
+                }
+                Serial.print("ms:"); Serial.print(row.stats->getLatenessCount(b));
+            }
+        } else {
+            Serial.print(": event-driven");
+        }
+        if (row.watched) {
+            Serial.print(", longest watchdog gap "); Serial.print(row.stats->getMaxGapUs() / 1000.0, 1);
+            Serial.print("ms of "); Serial.print(WDT_TIMEOUT_S * 1000); Serial.print("ms");
+        }
+        Serial.println();
+    }
+}
+
+
+// Debounces the buttons and publishes presses and long presses. Returns
+// how long the UI task may sleep before the buttons need another look,
+// UINT32_MAX when they are idle and the edge interrupt will wake it.
+uint32_t pollButtons() {
+    static Button* const buttons[] = {&btnLeft, &btnRight, &btnBack, &btnSelect};
+    static const uint8_t pins[] = {BTN_LEFT, BTN_RIGHT, BTN_BACK, BTN_SELECT};
+    static bool longSent[] = {false, false, false, false};
+    uint32_t waitMs = UINT32_MAX;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        buttons[i]->update();
+        Event event;
+        event.type = EVENT_BUTTON;
+        event.button.button = pins[i];
+
+        if (buttons[i]->wasPressed()) {
+            longSent[i] = false;
+            event.button.action = BUTTON_PRESS;
+            bus.publish(event, millis());
+        }
+        // isLongPress() latches until the next press; publish it once
+        if (buttons[i]->isLongPress() && !longSent[i]) {
+            longSent[i] = true;
+            event.button.action = BUTTON_LONG;
+            bus.publish(event, millis());
+        }
+
+        if (buttons[i]->isSettling()) {
+            waitMs = min(waitMs, (uint32_t)DEBOUNCE_DELAY + 1);
+        } else if (buttons[i]->isPressed() && !longSent[i]) {
+            uint32_t held = buttons[i]->getPressTime();
+            waitMs = min(waitMs, held < LONG_PRESS_TIME ? LONG_PRESS_TIME - held + 1 : 1);
+        }
+    }
+    return waitMs;
+}
 
+void publishConfigChange(uint8_t source) {
+    Event event;
+    event.type = EVENT_CONFIG;
+    event.config.phase_count = powerMonitor.getPhaseCount();
+    event.config.source = source;
+    bus.publish(event, millis());
+}
+
+// Applies one button event to the menu; returns true if the screen changed
+bool handleButton(const ButtonAction& input) {
     // Handle SELECT button long press
-    if (!inSettings && btnSelect.isLongPress()) {
-        inSettings = true;
-        displayMode = DISPLAY_SET;
-        displayNeedsUpdate = true;
+    if (input.action == BUTTON_LONG) {
+        if (!inSettings && input.button == BTN_SELECT) {
+            inSettings = true;
+            displayMode = DISPLAY_SET;
+            return true;
+        }
+        return false;
     }
 
-    // Handle button presses
-    if (btnSelect.wasPressed()) {
+    switch (input.button) {
+    case BTN_SELECT:
         if (!inSettings) {
-            // Toggle between V/I and P/E displays
-            displayMode = (displayMode == DISPLAY_VI) ? DISPLAY_PE : DISPLAY_VI;
-            displayNeedsUpdate = true;
-        } else if (inSettings) {
+            // Cycle through the V/I, P/E and forecast displays
+            displayMode = (displayMode == DISPLAY_VI) ? DISPLAY_PE :
+                          (displayMode == DISPLAY_PE) ? DISPLAY_FC : DISPLAY_VI;
+        } else {
             // Toggle phase setting selection
             phaseSettingSelected = !phaseSettingSelected;
-            displayNeedsUpdate = true;
         }
-    }
-
-    if (inSettings && phaseSettingSelected) {
-        if (btnLeft.wasPressed() || btnRight.wasPressed()) {
-            // Toggle between single and three phase
-            if (powerMonitor.getPhaseCount() == THREE_PHASE) {
-                powerMonitor = PowerMonitor(CURRENT_PIN, VOLTAGE_PIN, SINGLE_PHASE);
-            } else {
-                powerMonitor = PowerMonitor(CURRENT_PIN, VOLTAGE_PIN, THREE_PHASE);
+        return true;
+
+    case BTN_LEFT:
+    case BTN_RIGHT:
+        if (inSettings && phaseSettingSelected) {
+            // Toggle between single and three phase; the acquisition task
+            // applies it before its next window, and that window's snapshot
+            // redraws this screen
+            uint8_t phaseMode = shownPhaseCount() == THREE_PHASE ? SINGLE_PHASE : THREE_PHASE;
+            if (powerMonitor.reconfigure(monitorConfigFor(phaseMode), CONFIG_FROM_BUTTON)) {
+                saveSettings(phaseMode); // Save settings after phase mode change
             }
-            powerMonitor.begin();
-            saveSettings(); // Save settings after phase mode change
-            displayNeedsUpdate = true;
+            return false;
         }
+        return false;
+
+    case BTN_BACK:
+        if (inSettings) {
+            inSettings = false;
+            phaseSettingSelected = false;
+            displayMode = DISPLAY_VI;
+            return true;
+        }
+        return false;
     }
-
-    if (inSettings && btnBack.wasPressed()) {
-        inSettings = false;
-        phaseSettingSelected = false;
-        displayMode = DISPLAY_VI;
-        displayNeedsUpdate = true;
-    }
-
-    return displayNeedsUpdate;
+    return false;
 }
 
 void updateDisplay() {
@@ -251,12 +728,19 @@ void updateDisplay() {
     }
 }
 
+// Phase mode of the last published window; the UI task never reads the monitor
+uint8_t shownPhaseCount() {
+    Measurement m;
+    return snapshot.read(m) && (m.flags & MEAS_THREE_PHASE) ? THREE_PHASE : SINGLE_PHASE;
+}
+
 void displaySettingsScreen() {
     static uint8_t lastPhaseCount = 0;
     static bool lastPhaseSelected = false;
+    uint8_t phaseCount = shownPhaseCount();
 
     // Only update if something changed
-    if (lastPhaseCount == powerMonitor.getPhaseCount() && 
+    if (lastPhaseCount == phaseCount &&
         lastPhaseSelected == phaseSettingSelected) {
         return;
     }
@@ -266,7 +750,7 @@ void displaySettingsScreen() {
     lcd.setCursor(0, 0);
     lcd.print("Phase Mode:");
     lcd.setCursor(0, 1);
-    lcd.print(powerMonitor.getPhaseCount() == THREE_PHASE ? "Three Phase" : "Single Phase");
+    lcd.print(phaseCount == THREE_PHASE ? "Three Phase" : "Single Phase");
 
     if (phaseSettingSelected) {
         lcd.setCursor(15, 1);
@@ -274,7 +758,7 @@ void displaySettingsScreen() {
     }
 
     // Save current state
-    lastPhaseCount = powerMonitor.getPhaseCount();
+    lastPhaseCount = phaseCount;
     lastPhaseSelected = phaseSettingSelected;
 }
 
@@ -284,18 +768,28 @@ void displayMonitorScreen() {
     static float lastPower = -1;
     static float lastEnergy = -1;
     static bool lastMWhState = false;
+    static uint32_t lastForecastFlag = 0;
+    static float lastNextHour = -1;
+    static float lastDay = -1;
     static uint8_t lastDisplayMode = 255;  // Force initial update
 
-    float voltage = powerMonitor.getVoltageAC();
-    float current = powerMonitor.getCurrentAC();
-    float power = powerMonitor.getPowerW();
-    float energy = powerMonitor.isAboveMWhThreshold() ? 
-                   powerMonitor.getEnergyMWh() : 
-                   powerMonitor.getEnergyKWh();
-    bool mwhState = powerMonitor.isAboveMWhThreshold();
+    // One window's values, never a mix of two
+    Measurement m;
+    if (!snapshot.read(m) || m.window == 0) {
+        return;
+    }
+    float voltage = m.voltage_v;
+    float current = m.current_a;
+    float power = m.power_w;
+    bool mwhState = m.flags & MEAS_ABOVE_MWH;
+    float energy = mwhState ? m.energy_kwh * KWH_TO_MWH : m.energy_kwh;
+    uint32_t forecastFlag = m.flags & MEAS_FORECAST;
 
     // Check if values changed significantly or display mode changed
     bool needsUpdate = (abs(voltage - lastVoltage) >= 0.1) ||
+                      (forecastFlag != lastForecastFlag) ||
+                      (abs(m.next_hour_wh - lastNextHour) >= 1) ||
+                      (abs(m.day_kwh - lastDay) >= 0.01) ||
                       (abs(current - lastCurrent) >= 0.01) ||
                       (abs(power - lastPower) >= 0.1) ||
                       (abs(energy - lastEnergy) >= 0.001) ||
@@ -312,7 +806,28 @@ void displayMonitorScreen() {
         lastDisplayMode = displayMode;
     }
 
-    if (displayMode == DISPLAY_PE) {
+    if (displayMode == DISPLAY_FC) {
+        lcd.setCursor(0, 0);
+        if (!forecastFlag) {
+            // The model needs a full day of hours first
+            lcd.print("Forecast: needs ");
+            lcd.setCursor(0, 1);
+            lcd.print("24h of data     ");
+        } else {
+            // Next hour in Wh, today's total in kWh, each with its band
+            lcd.print("H: ");
+            lcd.print(m.next_hour_wh, 0);
+            lcd.print("+/-");
+            lcd.print(m.next_hour_band_wh, 0);
+            lcd.print("Wh    ");
+            lcd.setCursor(0, 1);
+            lcd.print("D: ");
+            lcd.print(m.day_kwh, 1);
+            lcd.print("+/-");
+            lcd.print(m.day_band_kwh, 1);
+            lcd.print("kWh   ");
+        }
+    } else if (displayMode == DISPLAY_PE) {
         // Update power display with automatic unit conversion
         lcd.setCursor(0, 0);
         lcd.print("P: ");
@@ -337,7 +852,7 @@ void displayMonitorScreen() {
         lcd.print("V: ");
         lcd.print(voltage, 1);
         lcd.print("V");
-        if (powerMonitor.getPhaseCount() == THREE_PHASE) {
+        if (m.flags & MEAS_THREE_PHASE) {
             lcd.print("(3P)");
         } else {
             lcd.print("    ");  // Clear 3P if not used
@@ -356,6 +871,9 @@ void displayMonitorScreen() {
     lastPower = power;
     lastEnergy = energy;
     lastMWhState = mwhState;
+    lastForecastFlag = forecastFlag;
+    lastNextHour = m.next_hour_wh;
+    lastDay = m.day_kwh;
 }
 
 String getTimeStamp() {
@@ -375,37 +893,310 @@ String createFileName() {
 }
 
 void logPowerData() {
-    // Check if we need to create a new file for a new day
+    static uint8_t billingMonth = 0;
+    DateTime now = rtc.now();
+    String timestamp = getTimeStamp();
     String newFileName = createFileName();
-    if (newFileName != currentFileName) {
+    bool newDay = newFileName != currentFileName;
+    bool billingClosed = billingMonth != 0 && now.month() != billingMonth;
+    billingMonth = now.month();
+
+    // Copy what this entry prints under the lock; Serial and SD run after
+    // it is released so no window waits on them
+    Measurement m;
+    float demand, peakDemand, lastPeriodPeak = 0, overRangeKWh;
+    uint32_t saturatedWindows;
+    TariffReport closedTariff, tariffNow;
+    PercentileReport yesterday;
+    {
+        MonitorLock lock;
+
+        // Keep the monitor clock on RTC time and roll the demand billing period monthly
+        powerMonitor.syncClock(now.unixtime());
+        if (billingClosed) {
+            powerMonitor.getDemand().startBillingPeriod();
+            lastPeriodPeak = powerMonitor.getDemand().getLastPeriodPeakW();
+            closedTariff.copy();
+            tariff.resetRegisters();
+        }
+
+        snapshot.read(m);
+        demand = powerMonitor.getDemand().getRollingDemandW();
+        peakDemand = powerMonitor.getDemand().getPeakBlockDemandW();
+        saturatedWindows = powerMonitor.getSaturatedWindows();
+        overRangeKWh = powerMonitor.getOverRangeEnergyKWh();
+        tariffNow.copy();
+        if (newDay) {
+            yesterday.copy();
+        }
+    }
+
+    if (billingClosed) {
+        Serial.print("Billing period closed, peak demand: ");
+        Serial.print(lastPeriodPeak, 1);
+        Serial.println("W");
+        closedTariff.print();
+    }
+
+    String dataString = timestamp + "," +
+                        String(m.voltage_v, 1) + "," +
+                        String(m.current_a, 2) + "," +
+                        String(m.power_w, 1) + "," +
+                        String(m.energy_kwh, 3) + "," +
+                        String(demand, 1) + "," +
+                        String(peakDemand, 1);
+    bool haveForecast = m.flags & MEAS_FORECAST;
+    dataString += haveForecast ?
+                  "," + String(m.next_hour_wh, 0) + "," + String(m.next_hour_band_wh, 0) +
+                  "," + String(m.day_kwh, 2) + "," + String(m.day_band_kwh, 2) :
+                  String(",,,,");
+
+    // Check if we need to create a new file for a new day
+    if (newDay) {
         currentFileName = newFileName;
         File dataFile = SD.open(currentFileName, FILE_WRITE);
         if (dataFile) {
-            dataFile.println("Timestamp,Voltage(V),Current(A),Power(W),Energy(kWh)");
+            dataFile.println(LOG_HEADER);
             dataFile.close();
             Serial.println("Created new log file: " + currentFileName);
         }
+        yesterday.print();
     }
 
-    // Get current readings
-    float ac_voltage = powerMonitor.getVoltageAC();
-    float ac_current = powerMonitor.getCurrentAC();
-    float power = powerMonitor.getPowerW();
-    float energy = powerMonitor.getEnergyKWh();
-
-    String timestamp = getTimeStamp();
-    String dataString = timestamp + "," +
-                        String(ac_voltage, 1) + "," +
-                        String(ac_current, 2) + "," +
-                        String(power, 1) + "," +
-                        String(energy, 3);
-
     File dataFile = SD.open(currentFileName, FILE_APPEND);
     if (dataFile) {
         dataFile.println(dataString);
         dataFile.close();
         Serial.println("Data logged: " + dataString);
     }
+
+    if (haveForecast) {
+        Serial.print("Forecast next hour: ");
+        Serial.print(m.next_hour_wh, 0);
+        Serial.print("Wh +/-"); Serial.print(m.next_hour_band_wh, 0);
+        Serial.print("Wh, end of day: ");
+        Serial.print(m.day_kwh, 2);
+        Serial.print("kWh +/-"); Serial.print(m.day_band_kwh, 2); Serial.println("kWh");
+    }
+
+    if (saturatedWindows > 0) {
+        Serial.print("Over range: ");
+        Serial.print(saturatedWindows);
+        Serial.print(" clipped windows, est. missed energy ");
+        Serial.print(overRangeKWh, 3);
+        Serial.println("kWh");
+    }
+
+    tariffNow.print();
+}
+
+// Example two-season, three-band schedule; edit to match the supply contract
+void setupTariff() {
+    uint8_t offPeak = tariff.addBand("Off", 0.10);
+    uint8_t midPeak = tariff.addBand("Mid", 0.15);
+    uint8_t onPeak = tariff.addBand("Peak", 0.30);
+
+    tariff.setSeason(0, 10, 3);   // Winter: October to March
+    tariff.setSeason(1, 4, 9);    // Summer: April to September
+    for (uint8_t season = 0; season < 2; season++) {
+        tariff.setBand(season, DAY_WEEKDAY, 0, 0, offPeak);
+        tariff.setBand(season, DAY_WEEKDAY, 700, 2300, midPeak);
+        tariff.setBand(season, DAY_WEEKEND, 0, 0, offPeak);
+        tariff.setBand(season, DAY_HOLIDAY, 0, 0, offPeak);
+    }
+    tariff.setBand(0, DAY_WEEKDAY, 1700, 2100, onPeak);  // Winter evening peak
+    tariff.setBand(1, DAY_WEEKDAY, 1200, 1600, onPeak);  // Summer afternoon peak
+    tariff.addHoliday(0, 1, 1);     // Every year
+    tariff.addHoliday(0, 12, 25);
+
+    // The RTC is set from the compile time and so already keeps local time
+    tariff.setTimezone(0, DST_NONE);
+}
+
+void TariffReport::copy() {
+    current = tariff.getCurrentBand();
+    bands = tariff.getBandCount();
+    for (uint8_t b = 0; b < bands; b++) {
+        kwh[b] = tariff.getBandKWh(b);
+        cost[b] = tariff.getBandCost(b);
+    }
+    total_cost = tariff.getTotalCost();
+}
+
+// Band names are fixed after setupTariff(), so they are read directly
+void TariffReport::print() const {
+    Serial.print("Tariff [");
+    Serial.print(tariff.getBand(current).name);
+    Serial.print("]");
+    for (uint8_t b = 0; b < bands; b++) {
+        Serial.print(" ");
+        Serial.print(tariff.getBand(b).name); Serial.print(": ");
+        Serial.print(kwh[b], 3); Serial.print("kWh/");
+        Serial.print(cost[b], 2);
+    }
+    Serial.print(", total cost: ");
+    Serial.println(total_cost, 2);
+}
+
+MonitorConfig monitorConfigFor(uint8_t phaseMode) {
+    return (phaseMode == THREE_PHASE) ?
+        MonitorConfig::three(THREE_PHASE_CURRENT_PINS, THREE_PHASE_VOLTAGE_PINS) :
+        MonitorConfig::single(CURRENT_PIN, VOLTAGE_PIN);
+}
+
+// Collects a line from Serial without blocking
+void handleSerial() {
+    static char line[SERIAL_LINE_MAX];
+    static uint8_t length = 0;
+
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (length < SERIAL_LINE_MAX - 1) line[length++] = c;
+            continue;
+        }
+        line[length] = 0;
+        length = 0;
+        if (strncmp(line, "cal ", 4) == 0) {
+            handleCalibrationCommand(line + 4);
+        } else if (strcmp(line, "timing") == 0) {
+            printTimingReport();
+        } else if (line[0]) {
+            Serial.println("Unknown command");
+        }
+    }
+}
+
+// Takes the monitor lock for each change and prints after releasing it
+void handleCalibrationCommand(const char* args) {
+    if (strcmp(args, "abort") == 0) {
+        {
+            MonitorLock lock;
+            powerMonitor.abortCalibration();
+        }
+        Serial.println("Calibration step aborted");
+        return;
+    }
+    if (strcmp(args, "clear") == 0) {
+        {
+            MonitorLock lock;
+            powerMonitor.clearCalibration();
+            powerMonitor.saveCalibration();
+        }
+        Serial.println("Calibration cleared");
+        return;
+    }
+    if (strcmp(args, "solve") == 0) {
+        CalibrationResult result;
+        bool solved;
+        {
+            MonitorLock lock;
+            solved = powerMonitor.applyCalibration(result);
+            if (solved) powerMonitor.saveCalibration();
+        }
+        if (!solved) {
+            Serial.println("Calibration needs a loaded step first");
+            return;
+        }
+        printCalibrationResult(result);
+        return;
+    }
+
+    char phase;
+    float volts, amps, watts = -1;
+    int fields = sscanf(args, "%c %f %f %f", &phase, &volts, &amps, &watts);
+    if (fields < 3 || phase < 'a' || phase > 'c') {
+        Serial.println("Usage: cal <a|b|c> <volts> <amps> [watts] | solve | clear | abort");
+        return;
+    }
+    bool started;
+    {
+        MonitorLock lock;
+        started = powerMonitor.startCalibration(phase - 'a', volts, amps, watts);
+    }
+    if (!started) {
+        Serial.println("Calibration step rejected");
+        return;
+    }
+    Serial.print("Calibrating phase "); Serial.print((char)(phase - 'a' + 'A'));
+    Serial.print(" at "); Serial.print(amps, 3); Serial.println("A");
+}
+
+void printCalibrationResult(const CalibrationResult& result) {
+    Serial.print("Voltage gain "); Serial.print(result.voltage_gain, 4);
+    Serial.print(" offset "); Serial.print(result.voltage_offset, 2);
+    Serial.print("V, fit error "); Serial.print(result.max_voltage_error_pct, 2); Serial.println("%");
+    for (uint8_t k = 0; k < result.points; k++) {
+        Serial.print("  "); Serial.print(result.current[k], 3);
+        Serial.print("A gain "); Serial.print(result.gain[k], 4);
+        Serial.print(" phase "); Serial.print(result.phase_deg[k], 2); Serial.println("deg");
+    }
+    Serial.print("Current error bound "); Serial.print(result.max_current_error_pct, 2);
+    Serial.print("%, residual offset "); Serial.print(result.current_offset_a, 4); Serial.println("A");
+}
+
+// Gain ranges and compiled-in calibration, before begin()
+void configureInputs(PowerMonitor& monitor) {
+    monitor.addGainRange(NO_PIN, ADC_11db, 1.0, 1.0, ADC_MIDPOINT);
+    monitor.addGainRange(NO_PIN, ADC_6db, RANGE_6DB_GAIN, 1.0, RANGE_6DB_BIAS);
+    if (HIGH_GAIN_PIN != NO_PIN) {
+        monitor.addGainRange(HIGH_GAIN_PIN, ADC_6db, HIGH_GAIN, 1.0, HIGH_GAIN_BIAS);
+    }
+
+    const CalibrationPoint* tables[PHASES] = {CURRENT_CAL_A, CURRENT_CAL_B, CURRENT_CAL_C};
+    const uint8_t counts[PHASES] = {
+        sizeof(CURRENT_CAL_A) / sizeof(CalibrationPoint),
+        sizeof(CURRENT_CAL_B) / sizeof(CalibrationPoint),
+        sizeof(CURRENT_CAL_C) / sizeof(CalibrationPoint)};
+    for (uint8_t p = 0; p < PHASES; p++) {
+        CalibrationTable table;
+        table.setPoints(tables[p], counts[p]);
+        monitor.setCurrentCalibration(p, table);
+    }
+}
+
+void printLoadEvent(const LoadEvent& event) {
+    Serial.print("Load event: ");
+    Serial.print(event.signature == UNKNOWN_LOAD ? "Unknown" : loadEvents.getSignature(event.signature).name);
+    Serial.print(event.on ? " ON " : " OFF ");
+    Serial.print(event.delta_p, 0); Serial.print("W ");
+    Serial.print(event.delta_q, 0); Serial.println("var");
+}
+
+void printAnomalyEvent(const AnomalyEvent& event) {
+    static const char* const kinds[ANOMALY_KINDS] = {"Voltage", "Current", "Power", "Base load"};
+    Serial.print("Anomaly: ");
+    Serial.print(kinds[event.kind]);
+    Serial.print(" "); Serial.print(event.value, 2);
+    Serial.print(" expected "); Serial.print(event.expected, 2);
+    Serial.print(" z="); Serial.println(event.z, 1);
+}
+
+void PercentileReport::copy() {
+    static const float quantiles[3] = {0.50, 0.95, 0.99};
+    const QuantileSketch& currentDay = percentiles.getCurrentYesterday();
+    const QuantileSketch& powerDay = percentiles.getPowerYesterday();
+    valid = currentDay.getCount() > 0;
+    for (uint8_t q = 0; q < 3; q++) {
+        current[q] = currentDay.quantile(quantiles[q]);
+        power[q] = powerDay.quantile(quantiles[q]);
+    }
+}
+
+void PercentileReport::print() const {
+    if (!valid) {
+        return;
+    }
+
+    Serial.print("Yesterday current P50/P95/P99: ");
+    Serial.print(current[0], 2); Serial.print("/");
+    Serial.print(current[1], 2); Serial.print("/");
+    Serial.print(current[2], 2); Serial.println("A");
+    Serial.print("Yesterday power P50/P95/P99: ");
+    Serial.print(power[0], 1); Serial.print("/");
+    Serial.print(power[1], 1); Serial.print("/");
+    Serial.print(power[2], 1); Serial.println("W");
 }
 
 // Add debug messages to loadSettings() function
@@ -417,29 +1208,29 @@ void loadSettings() {
         Serial.println(phaseMode);
 
         if (phaseMode == THREE_PHASE || phaseMode == SINGLE_PHASE) {
-            // Create new power monitor with saved phase mode
-            powerMonitor = PowerMonitor(CURRENT_PIN, VOLTAGE_PIN, phaseMode);
+            // Applied by begin()
+            powerMonitor.reconfigure(monitorConfigFor(phaseMode), CONFIG_FROM_BOOT);
             Serial.print("Loaded phase mode from EEPROM: ");
             Serial.println(phaseMode == THREE_PHASE ? "Three Phase" : "Single Phase");
         } else {
             Serial.println("Invalid phase mode in EEPROM, using default");
-            saveSettings(); // Save default settings
+            saveSettings(SINGLE_PHASE); // Save default settings
         }
     } else {
         Serial.println("No valid settings found in EEPROM");
         Serial.println("Saving default settings (Single Phase)");
-        saveSettings();
+        saveSettings(SINGLE_PHASE);
     }
 }
 
 // Add debug messages to saveSettings() function
-void saveSettings() {
+void saveSettings(uint8_t phaseMode) {
     Serial.println("\nSaving settings to EEPROM...");
     Serial.print("Phase mode: ");
-    Serial.println(powerMonitor.getPhaseCount() == THREE_PHASE ? "Three Phase" : "Single Phase");
+    Serial.println(phaseMode == THREE_PHASE ? "Three Phase" : "Single Phase");
 
     EEPROM.write(SETTINGS_VALID_ADDR, SETTINGS_VALID_VALUE);
-    EEPROM.write(PHASE_MODE_ADDR, powerMonitor.getPhaseCount());
+    EEPROM.write(PHASE_MODE_ADDR, phaseMode);
 
     if (EEPROM.commit()) {
         Serial.println("Settings saved successfully");
@@ -0,0 +1,117 @@
+#include "forecaster.h"
+#include <math.h>
+#include <string.h>
+
+#define SECONDS_PER_HOUR 3600
+
+EnergyForecaster::EnergyForecaster() {
+    reset();
+}
+
+void EnergyForecaster::reset() {
+    _level = 0;
+    _trend = 0;
+    memset(_season, 0, sizeof(_season));
+    _error_sq = 0;
+    _last_hour = 0;
+    _init_count = 0;
+    _ready = false;
+}
+
+void EnergyForecaster::addHour(uint32_t hour_start_s, float energy_wh) {
+    uint32_t hour = hour_start_s / SECONDS_PER_HOUR;
+    uint8_t slot = hour % FORECAST_SEASON;
+
+    if (_init_count > 0 || _ready) {
+        uint32_t gap = hour - _last_hour;
+        if (hour <= _last_hour || gap > FORECAST_MAX_GAP) {
+            reset();
+        } else if (_ready) {
+            // Let the model coast through missing hours
+            for (uint32_t h = 1; h < gap; h++) {
+                _level += _trend;
+            }
+        } else if (gap != 1) {
+            reset();
+        }
+    }
+    _last_hour = hour;
+
+    if (!_ready) {
+        // First full day: seasonal indices relative to its mean
+        _season[slot] = energy_wh;
+        _level += energy_wh / FORECAST_SEASON;
+        if (++_init_count == FORECAST_SEASON) {
+            for (uint8_t i = 0; i < FORECAST_SEASON; i++) {
+                _season[i] -= _level;
+            }
+            _ready = true;
+        }
+        return;
+    }
+
+    step(slot, energy_wh);
+}
+
+void EnergyForecaster::step(uint8_t slot, float energy_wh) {
+    float predicted = _level + _trend + _season[slot];
+    float error = energy_wh - predicted;
+    _error_sq += FORECAST_ERROR_ALPHA * (error * error - _error_sq);
+
+    float last_level = _level;
+    _level = FORECAST_ALPHA * (energy_wh - _season[slot]) +
+             (1.0f - FORECAST_ALPHA) * (_level + _trend);
+    _trend = FORECAST_BETA * (_level - last_level) + (1.0f - FORECAST_BETA) * _trend;
+    _season[slot] = FORECAST_GAMMA * (energy_wh - _level) +
+                    (1.0f - FORECAST_GAMMA) * _season[slot];
+}
+
+bool EnergyForecaster::isCurrent(uint32_t now_s) const {
+    uint32_t hour = now_s / SECONDS_PER_HOUR;
+    return _ready && hour > _last_hour && hour - _last_hour <= FORECAST_MAX_GAP;
+}
+
+float EnergyForecaster::forecastWh(uint32_t hours_ahead) const {
+    if (!_ready || hours_ahead == 0) return 0;
+    uint8_t slot = (_last_hour + hours_ahead) % FORECAST_SEASON;
+    float value = _level + _trend * hours_ahead + _season[slot];
+    return value > 0 ? value : 0;
+}
+
+float EnergyForecaster::getErrorRmsWh() const {
+    return sqrtf(_error_sq);
+}
+
+float EnergyForecaster::getBandWh(uint32_t hours_ahead) const {
+    // One-step errors treated as independent across the horizon
+    return FORECAST_Z * getErrorRmsWh() * sqrtf(hours_ahead > 0 ? hours_ahead : 1);
+}
+
+float EnergyForecaster::forecastNextHourWh(uint32_t now_s, float& band_wh) const {
+    band_wh = 0;
+    if (!isCurrent(now_s)) return 0;
+
+    // The hour holding now_s is still open, so the next one is a step further
+    uint32_t ahead = now_s / SECONDS_PER_HOUR - _last_hour + 1;
+    band_wh = getBandWh(ahead);
+    return forecastWh(ahead);
+}
+
+float EnergyForecaster::forecastRestOfDayWh(uint32_t now_s, float this_hour_wh, float& band_wh) const {
+    band_wh = 0;
+    if (!isCurrent(now_s)) return 0;
+
+    uint32_t hour = now_s / SECONDS_PER_HOUR;
+    uint32_t hours_left = FORECAST_SEASON - hour % FORECAST_SEASON;  // Including this one
+
+    // Remaining part of the current hour, then every later hour of the day
+    uint32_t ahead = hour - _last_hour;
+    float total = forecastWh(ahead) - this_hour_wh;
+    if (total < 0) total = 0;
+    for (uint32_t h = 1; h < hours_left; h++) {
+        total += forecastWh(ahead + h);
+    }
+
+    band_wh = getBandWh(hours_left);
+    return total;
+}
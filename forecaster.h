@@ -0,0 +1,46 @@
+#ifndef FORECASTER_H
+#define FORECASTER_H
+
+#include <stdint.h>
+
+// Holt-Winters Configuration
+#define FORECAST_SEASON 24          // Hourly samples per daily season
+#define FORECAST_ALPHA 0.25         // Level smoothing
+#define FORECAST_BETA 0.01          // Trend smoothing
+#define FORECAST_GAMMA 0.20         // Seasonal smoothing
+#define FORECAST_ERROR_ALPHA 0.05   // Smoothing of squared one-step error
+#define FORECAST_Z 1.96             // Band half-width in standard errors (~95%)
+#define FORECAST_MAX_GAP 24         // Missing hours stepped over before a restart
+
+// Additive Holt-Winters on hourly energy with daily seasonality.
+// The first day initializes level and seasonal indices; after that each
+// closed hour costs one update of constant time. State is ~120 bytes.
+class EnergyForecaster {
+public:
+    EnergyForecaster();
+    void reset();
+    void addHour(uint32_t hour_start_s, float energy_wh);     // Feed one closed hour
+
+    bool isReady() const { return _ready; }
+    bool isCurrent(uint32_t now_s) const;   // Ready, and no more than FORECAST_MAX_GAP hours behind now_s
+    float forecastWh(uint32_t hours_ahead) const;             // 1 = the hour after the last fed
+    float getBandWh(uint32_t hours_ahead = 1) const;          // Half-width of the band
+
+    // The hour after the one holding now_s; 0 and no band unless isCurrent()
+    float forecastNextHourWh(uint32_t now_s, float& band_wh) const;
+    float forecastRestOfDayWh(uint32_t now_s, float this_hour_wh, float& band_wh) const;
+    float getErrorRmsWh() const;
+
+private:
+    float _level;
+    float _trend;
+    float _season[FORECAST_SEASON];
+    float _error_sq;            // EWMA of squared one-step error
+    uint32_t _last_hour;        // Hour number of the last sample fed
+    uint8_t _init_count;        // Hours collected for initialization
+    bool _ready;
+
+    void step(uint8_t slot, float energy_wh);
+};
+
+#endif
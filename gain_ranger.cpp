@@ -0,0 +1,97 @@
+#include "gain_ranger.h"
+
+GainRanger::GainRanger()
+    : _count(0), _active(0), _settle(0), _down_run(0), _switches(0) {}
+
+int8_t GainRanger::addRange(uint8_t pin, uint8_t attenuation, float gain, float cal, float initial_bias) {
+    if (_count >= MAX_GAIN_RANGES || gain <= 0) return -1;
+
+    // Keep ranges sorted coarsest first
+    uint8_t slot = _count;
+    while (slot > 0 && _ranges[slot - 1].gain > gain) {
+        _ranges[slot] = _ranges[slot - 1];
+        slot--;
+    }
+    GainRange& r = _ranges[slot];
+    r.pin = pin;
+    r.attenuation = attenuation;
+    r.gain = gain;
+    r.cal = cal;
+    r.bias = initial_bias;
+    r.bias_learned = false;
+    _count++;
+    _active = 0;                // Start in the coarsest range
+    return slot;
+}
+
+float GainRanger::getScale() const {
+    if (_count == 0) return 1.0f;
+    return _ranges[_active].cal / _ranges[_active].gain;
+}
+
+void GainRanger::restoreBias(uint8_t range, float bias) {
+    if (range >= _count) return;
+    _ranges[range].bias = bias;
+    _ranges[range].bias_learned = true;
+}
+
+// Keeps the learned biases; only the range choice and its run state restart
+void GainRanger::reset(CtDetector& window) {
+    if (_count == 0) return;
+    _ranges[_active].bias = window.getBias();
+    _ranges[_active].bias_learned = true;
+    _active = 0;
+    _settle = 0;
+    _down_run = 0;
+    window.setBias(_ranges[0].bias);
+}
+
+void GainRanger::select(uint8_t range, CtDetector& window) {
+    _ranges[_active].bias = window.getBias();
+    _ranges[_active].bias_learned = true;
+    _active = range;
+    _settle = RANGE_SETTLE_WINDOWS;
+    _down_run = 0;
+    _switches++;
+    window.setBias(_ranges[range].bias);
+}
+
+bool GainRanger::endWindow(CtDetector& window) {
+    if (_count < 2) return true;
+
+    GainRange& r = _ranges[_active];
+    if (_settle > 0) {
+        _settle--;
+        // First visit: seat the bias on the settling window's mean
+        if (!r.bias_learned) {
+            r.bias = window.getRunningMean();
+            r.bias_learned = true;
+            window.setBias(r.bias);
+        }
+        return false;
+    }
+
+    float bias = window.getBias();
+    float up = window.getMaxRaw() - bias;
+    float down = bias - window.getMinRaw();
+
+    if (_active > 0 && (up >= RANGE_UP_FRACTION * (4095 - bias) || down >= RANGE_UP_FRACTION * bias)) {
+        select(_active - 1, window);
+        return false;           // Clipped or nearly so: not a good reading
+    }
+
+    if (_active + 1 < _count) {
+        const GainRange& finer = _ranges[_active + 1];
+        float scale = finer.gain / r.gain;
+        if (up * scale < RANGE_DOWN_FRACTION * (4095 - finer.bias) &&
+            down * scale < RANGE_DOWN_FRACTION * finer.bias) {
+            if (++_down_run >= RANGE_DOWN_WINDOWS) {
+                select(_active + 1, window);
+                return false;   // Stats belong to the old range's bias
+            }
+        } else {
+            _down_run = 0;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef GAIN_RANGER_H
+#define GAIN_RANGER_H
+
+#include <stdint.h>
+#include "ct_detector.h"
+
+// Gain Ranging
+#define MAX_GAIN_RANGES 3
+#define RANGE_UP_FRACTION 0.90  // Peak share of bias-to-rail span that forces a coarser range
+#define RANGE_DOWN_FRACTION 0.60 // Predicted peak share that allows a finer range
+#define RANGE_DOWN_WINDOWS 4    // Consecutive small windows before moving finer
+#define RANGE_SETTLE_WINDOWS 1  // Windows discarded after a switch
+
+// One input range of the current channel
+struct GainRange {
+    uint8_t pin;                // ADC pin sampled in this range
+    uint8_t attenuation;        // adc_attenuation_t applied to the pin
+    float gain;                 // Counts per count of the coarsest range
+    float cal;                  // Calibration multiplier of this range
+    float bias;                 // Channel bias in counts, learned once visited
+    bool bias_learned;
+};
+
+// Picks the finest range whose span holds the signal. A range is left
+// upward immediately when the peak nears a rail, and downward only after
+// RANGE_DOWN_WINDOWS windows that would fit the finer range with margin,
+// so ranges do not flap. The window that triggered a switch and the
+// settling windows that follow are discarded, so RMS and energy hold the
+// last good value instead of stepping.
+class GainRanger {
+public:
+    GainRanger();
+    int8_t addRange(uint8_t pin, uint8_t attenuation, float gain, float cal, float initial_bias);
+    bool endWindow(CtDetector& window);         // Call after each window; false to discard it
+
+    uint8_t getCount() const { return _count; }
+    uint8_t getActive() const { return _active; }
+    const GainRange& getRange(uint8_t range) const { return _ranges[range < _count ? range : 0]; }
+    float getScale() const;                     // Multiplier from active-range counts to coarse counts
+    void restoreBias(uint8_t range, float bias); // Seed a range with a bias learned before reboot
+    void reset(CtDetector& window);             // Back to the coarsest range, nothing left to discard
+    uint32_t getSwitches() const { return _switches; }
+
+private:
+    GainRange _ranges[MAX_GAIN_RANGES];         // Coarsest first
+    uint8_t _count;
+    uint8_t _active;
+    uint8_t _settle;            // Windows left to discard
+    uint8_t _down_run;          // Consecutive windows fitting the finer range
+    uint32_t _switches;
+
+    void select(uint8_t range, CtDetector& window);
+};
+
+#endif
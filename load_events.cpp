@@ -0,0 +1,115 @@
+#include "load_events.h"
+#include <math.h>
+#include <string.h>
+
+LoadEventDetector::LoadEventDetector()
+    : _signature_count(0), _event_head(0), _event_count(0), _total_events(0), _unknown_events(0),
+      _have_level(false), _level_p(0), _level_q(0),
+      _run_p(0), _run_q(0), _run_length(0) {
+    memset(_signatures, 0, sizeof(_signatures));
+    memset(_appliance_on, 0, sizeof(_appliance_on));
+    memset(_events, 0, sizeof(_events));
+}
+
+int8_t LoadEventDetector::addSignature(const char* name, float delta_p, float delta_q) {
+    if (_signature_count >= MAX_LOAD_SIGNATURES) return UNKNOWN_LOAD;
+
+    LoadSignature& sig = _signatures[_signature_count];
+    strncpy(sig.name, name, LOAD_NAME_LEN - 1);
+    sig.name[LOAD_NAME_LEN - 1] = '\0';
+    sig.delta_p = fabsf(delta_p);
+    sig.delta_q = delta_p < 0 ? -delta_q : delta_q;
+    sig.apparent = sqrtf(delta_p * delta_p + delta_q * delta_q);
+    _appliance_on[_signature_count] = false;
+    return _signature_count++;
+}
+
+void LoadEventDetector::clearSignatures() {
+    _signature_count = 0;
+    memset(_appliance_on, 0, sizeof(_appliance_on));
+}
+
+bool LoadEventDetector::update(uint32_t now_s, float power_w, float reactive_var, bool have_reactive) {
+    // Extend the current run while windows stay close to its mean
+    if (_run_length > 0 && fabsf(power_w - _run_p) <= STEADY_TOLERANCE_W &&
+        fabsf(reactive_var - _run_q) <= STEADY_TOLERANCE_W) {
+        _run_length++;
+        _run_p += (power_w - _run_p) / _run_length;
+        _run_q += (reactive_var - _run_q) / _run_length;
+    } else {
+        _run_p = power_w;
+        _run_q = reactive_var;
+        _run_length = 1;
+    }
+
+    if (_run_length < STEADY_WINDOWS) return false;
+
+    // Settled: compare with the previous level once, then track slow drift
+    bool logged = false;
+    if (_run_length == STEADY_WINDOWS && _have_level) {
+        float delta_p = _run_p - _level_p;
+        float delta_q = _run_q - _level_q;
+        if (fabsf(delta_p) >= STEP_THRESHOLD_W) {
+            logEvent(now_s, delta_p, delta_q, have_reactive);
+            logged = true;
+        }
+    }
+
+    _level_p = _run_p;
+    _level_q = _run_q;
+    _have_level = true;
+    if (_run_length == UINT16_MAX) _run_length = STEADY_WINDOWS + 1;
+    return logged;
+}
+
+int8_t LoadEventDetector::classify(float delta_p, float delta_q, bool have_reactive) const {
+    // Off steps are compared as the mirrored on step
+    float p = fabsf(delta_p);
+    float q = delta_p < 0 ? -delta_q : delta_q;
+
+    int8_t best = UNKNOWN_LOAD;
+    float best_distance = SIGNATURE_TOLERANCE;
+    for (uint8_t i = 0; i < _signature_count; i++) {
+        const LoadSignature& sig = _signatures[i];
+        float scale = sig.delta_p > STEP_THRESHOLD_W ? sig.delta_p : STEP_THRESHOLD_W;
+        float dp = p - sig.delta_p;
+        float dq = q - sig.delta_q;
+        if (!have_reactive) {
+            // Anywhere from P to |S| is a full match
+            scale = sig.apparent > STEP_THRESHOLD_W ? sig.apparent : STEP_THRESHOLD_W;
+            dp = p < sig.delta_p ? p - sig.delta_p : (p > sig.apparent ? p - sig.apparent : 0);
+            dq = 0;
+        }
+        float distance = sqrtf(dp * dp + dq * dq) / scale;
+        if (distance <= best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void LoadEventDetector::logEvent(uint32_t now_s, float delta_p, float delta_q, bool have_reactive) {
+    LoadEvent& event = _events[_event_head];
+    event.time = now_s;
+    event.delta_p = delta_p;
+    event.delta_q = delta_q;
+    event.on = delta_p > 0;
+    event.signature = classify(delta_p, delta_q, have_reactive);
+
+    if (event.signature == UNKNOWN_LOAD) {
+        _unknown_events++;
+    } else {
+        _appliance_on[event.signature] = event.on;
+    }
+
+    _total_events++;
+    _event_head = (_event_head + 1) % LOAD_EVENT_LOG;
+    if (_event_count < LOAD_EVENT_LOG) _event_count++;
+}
+
+bool LoadEventDetector::getEvent(uint8_t age, LoadEvent& out) const {
+    if (age >= _event_count) return false;
+    out = _events[(_event_head + LOAD_EVENT_LOG - 1 - age) % LOAD_EVENT_LOG];
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef LOAD_EVENTS_H
+#define LOAD_EVENTS_H
+
+#include <stdint.h>
+
+// Step Detection
+#define STEP_THRESHOLD_W 30.0       // Smallest real power step reported as an event
+#define STEADY_TOLERANCE_W 15.0     // Window-to-level spread still counted as steady
+#define STEADY_WINDOWS 5            // Windows a new level must hold before it counts
+#define SIGNATURE_TOLERANCE 0.15    // Match distance relative to the signature size
+
+// Signature Table and Event Log
+#define MAX_LOAD_SIGNATURES 8
+#define LOAD_EVENT_LOG 32
+#define LOAD_NAME_LEN 12
+#define UNKNOWN_LOAD -1
+
+// Known appliance: real and reactive step when it switches on
+struct LoadSignature {
+    char name[LOAD_NAME_LEN];
+    float delta_p;              // W
+    float delta_q;              // var
+    float apparent;             // VA, upper end of the span matched without Q
+};
+
+struct LoadEvent {
+    uint32_t time;              // Seconds since epoch when the new level settled
+    float delta_p;              // Step in real power, W
+    float delta_q;              // Step in reactive power, var
+    int8_t signature;           // Matched signature or UNKNOWN_LOAD
+    bool on;                    // Positive step
+};
+
+// NILM-style front end: detects settled steps in P/Q between consecutive
+// windows and classifies them against a fixed signature table.
+// Each window costs O(1) plus a scan of at most MAX_LOAD_SIGNATURES.
+// Without reactive power (single-phase) power_w is V x I. A step then
+// lands between the signature's real and apparent size, depending on the
+// power factor of the loads already running, so it is matched against that
+// span and Q is ignored.
+class LoadEventDetector {
+public:
+    LoadEventDetector();
+    int8_t addSignature(const char* name, float delta_p, float delta_q); // Index or UNKNOWN_LOAD if full
+    void clearSignatures();
+    bool update(uint32_t now_s, float power_w, float reactive_var, bool have_reactive = true); // True if an event was logged
+
+    uint8_t getSignatureCount() const { return _signature_count; }
+    const LoadSignature& getSignature(uint8_t index) const { return _signatures[index]; }
+    bool isApplianceOn(uint8_t index) const { return index < _signature_count && _appliance_on[index]; }
+    uint8_t getEventCount() const { return _event_count; }
+    bool getEvent(uint8_t age, LoadEvent& out) const;    // age 0 = newest
+    uint32_t getTotalEvents() const { return _total_events; }
+    uint32_t getUnknownEvents() const { return _unknown_events; }
+
+private:
+    LoadSignature _signatures[MAX_LOAD_SIGNATURES];
+    bool _appliance_on[MAX_LOAD_SIGNATURES];
+    uint8_t _signature_count;
+    LoadEvent _events[LOAD_EVENT_LOG];
+    uint8_t _event_head;        // Next slot to write
+    uint8_t _event_count;
+    uint32_t _total_events;     // Steps logged since boot
+    uint32_t _unknown_events;   // Steps that matched no signature
+    bool _have_level;           // A steady level has been established
+    float _level_p;             // Current steady level
+    float _level_q;
+    float _run_p;               // Mean of the run of similar windows
+    float _run_q;
+    uint16_t _run_length;
+
+    int8_t classify(float delta_p, float delta_q, bool have_reactive) const;
+    void logEvent(uint32_t now_s, float delta_p, float delta_q, bool have_reactive);
+};
+
+#endif
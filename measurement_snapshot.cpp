@@ -0,0 +1,42 @@
+#include "measurement_snapshot.h"
+#include <string.h>
+
+MeasurementSnapshot::MeasurementSnapshot() : _sequence(0), _retries(0) {
+    for (uint8_t w = 0; w < WORDS; w++) {
+        _words[w].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MeasurementSnapshot::publish(const Measurement& m) {
+    uint32_t words[WORDS];
+    memcpy(words, &m, sizeof(words));
+
+    uint32_t seq = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint8_t w = 0; w < WORDS; w++) {
+        _words[w].store(words[w], std::memory_order_relaxed);
+    }
+    _sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool MeasurementSnapshot::read(Measurement& m) const {
+    uint32_t words[WORDS];
+    for (uint8_t attempt = 0; attempt < SNAPSHOT_READ_TRIES; attempt++) {
+        uint32_t before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            _retries.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        for (uint8_t w = 0; w < WORDS; w++) {
+            words[w] = _words[w].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) == before) {
+            memcpy(&m, words, sizeof(words));
+            return true;
+        }
+        _retries.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#ifndef MEASUREMENT_SNAPSHOT_H
+#define MEASUREMENT_SNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Measurement flags
+#define MEAS_THREE_PHASE   0x01
+#define MEAS_CT_CONNECTED  0x02 // Single-phase CT present (always set in three-phase)
+#define MEAS_SATURATED     0x04 // Last window clipped the ADC
+#define MEAS_CALIBRATING   0x08 // Guided calibration step running
+#define MEAS_ABOVE_MWH     0x10 // Energy past MWH_THRESHOLD
+#define MEAS_FORECAST      0x20 // Forecast fields are valid
+
+#define SNAPSHOT_READ_TRIES 16  // Retries before read() gives up on a busy writer
+
+// One window's readings, copied as a unit
+struct Measurement {
+    uint32_t window;            // Window counter since begin(), 0 before the first
+    uint32_t unix_time;
+    float voltage_v;
+    float current_a;
+    float power_w;
+    float power_factor;
+    double energy_kwh;
+    float next_hour_wh;         // Forecast for the hour after this one
+    float next_hour_band_wh;    // ~95% half-width
+    float day_kwh;              // Forecast total for today
+    float day_band_kwh;
+    uint32_t flags;             // MEAS_* bits
+    uint32_t reserved;          // Keeps the size a multiple of 8
+};
+
+// Single-writer seqlock. The writer never waits: it bumps the sequence to
+// odd, stores the words and bumps it to even. Readers copy the words and
+// retry if the sequence was odd or moved, so a copy never mixes two
+// windows. Words are relaxed atomics, ordered by the sequence fences.
+class MeasurementSnapshot {
+public:
+    MeasurementSnapshot();
+    void publish(const Measurement& m);     // Writer task only
+    bool read(Measurement& m) const;        // Any task; false if the writer kept it busy
+    uint32_t getPublished() const { return _sequence.load(std::memory_order_relaxed) / 2; }
+    uint32_t getRetries() const { return _retries.load(std::memory_order_relaxed); }
+
+private:
+    static const uint8_t WORDS = sizeof(Measurement) / sizeof(uint32_t);
+    std::atomic<uint32_t> _sequence;        // Odd while a write is in progress
+    std::atomic<uint32_t> _words[WORDS];
+    mutable std::atomic<uint32_t> _retries; // Reads that overlapped a write
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "noise_floor.h"
+#include <math.h>
+
+NoiseFloor::NoiseFloor()
+    : _variance(NOISE_INITIAL_VAR), _step_variance(0), _idle_windows(0),
+      _windows(0), _restored(false) {}
+
+// The variance of N noise samples has a standard error of about sqrt(2/N)
+float NoiseFloor::threshold(uint32_t samples) const {
+    if (samples == 0) return INFINITY;
+    return _variance * (1.0f + NOISE_DETECT_SIGMA * sqrtf(2.0f / samples));
+}
+
+float NoiseFloor::slewShare(float mains_hz, float sample_rate_hz) {
+    if (sample_rate_hz <= 0) return 0;
+    float s = sinf(M_PI * mains_hz / sample_rate_hz);
+    return 2.0f * s * s;
+}
+
+void NoiseFloor::update(float variance, float step_noise, uint32_t samples, float slew_share) {
+    if (samples == 0 || variance < 0) return;
+
+    if (step_noise >= 0) {
+        // Steps of the mains wave itself are not noise
+        step_noise -= slew_share * variance;
+        if (step_noise < 0) step_noise = 0;
+        _step_variance = _windows == 0 ? step_noise :
+                         _step_variance + NOISE_STEP_RATE * (step_noise - _step_variance);
+        _windows++;
+    }
+
+    // Until the channel has been seen idle the step estimate is the floor
+    if (_idle_windows == 0 && !_restored && _windows > 0) {
+        _variance = _step_variance > NOISE_MIN_VAR ? _step_variance : NOISE_MIN_VAR;
+    }
+
+    if (variance < _variance) {
+        _variance += NOISE_FALL_RATE * (variance - _variance);
+    } else if (variance <= threshold(samples)) {
+        _variance += NOISE_RISE_RATE * (variance - _variance);
+    } else {
+        return;
+    }
+
+    if (_variance < NOISE_MIN_VAR) _variance = NOISE_MIN_VAR;
+    _idle_windows++;
+}
+
+bool NoiseFloor::isLearned() const {
+    return _restored || _idle_windows > 0 || _windows >= NOISE_LEARN_WINDOWS;
+}
+
+bool NoiseFloor::isSignal(float variance, uint32_t samples) const {
+    return variance > threshold(samples);
+}
+
+float NoiseFloor::signalRms(float variance, uint32_t samples) const {
+    if (!isSignal(variance, samples)) return 0;
+    return sqrtf(isLearned() ? variance - _variance : variance);
+}
+
+float NoiseFloor::getDetectionRms(uint32_t samples) const {
+    return sqrtf(threshold(samples) - (isLearned() ? _variance : 0));
+}
+
+float NoiseFloor::getRms() const {
+    return sqrtf(_variance);
+}
+
+void NoiseFloor::setVariance(float variance) {
+    _variance = variance > NOISE_MIN_VAR ? variance : NOISE_MIN_VAR;
+    _restored = true;
+}
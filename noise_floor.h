@@ -0,0 +1,53 @@
+#ifndef NOISE_FLOOR_H
+#define NOISE_FLOOR_H
+
+#include <stdint.h>
+
+// Noise Floor Estimation
+#define NOISE_INITIAL_VAR 64.0  // Counts^2 the first window's signal test uses; nothing is subtracted yet
+#define NOISE_MIN_VAR 0.25      // Lower bound of the estimate (half a count RMS)
+#define NOISE_FALL_RATE 0.25    // Weight of a window quieter than the estimate
+#define NOISE_RISE_RATE 0.01    // Weight of a louder window still consistent with noise
+#define NOISE_DETECT_SIGMA 4.0  // Signal threshold in standard errors of the noise variance
+#define NOISE_STEP_RATE 0.05    // EWMA weight of a window's step noise
+#define NOISE_LEARN_WINDOWS 1    // Step-noise windows before the floor is subtracted
+
+// Learns the ADC noise variance of a current channel and removes it from
+// window variances in quadrature. Half the mean squared sample-to-sample
+// step is the white noise power plus 2*sin^2(pi*f/fs) of a sampled mains
+// wave's variance (7.9e-5 at 50 Hz and 25 kHz, ten times a quiet board's
+// noise near full scale). With that share removed (slewShare()) every
+// window refines the estimate, so the floor is right at boot even with a
+// load on. Once idle windows are seen they take over: quieter windows pull
+// the floor down quickly and windows that are not a detected signal creep
+// it up, so a steady load is never absorbed. Until the floor is learned
+// nothing is subtracted.
+class NoiseFloor {
+public:
+    NoiseFloor();
+    // Once per window, counts^2; slew_share is slewShare() of the window's sampling
+    void update(float variance, float step_noise, uint32_t samples, float slew_share = 0);
+    bool isSignal(float variance, uint32_t samples) const;   // Above the floor by NOISE_DETECT_SIGMA
+    float signalRms(float variance, uint32_t samples) const; // Noise-free RMS counts, 0 if not a signal
+    float getDetectionRms(uint32_t samples) const;           // Smallest RMS counts isSignal() accepts
+    static float slewShare(float mains_hz, float sample_rate_hz); // Share of variance in the step noise
+
+    float getVariance() const { return _variance; }
+    float getRms() const;
+    void setVariance(float variance);                         // Restore a learned floor
+    bool isLearned() const;
+    uint32_t getIdleWindows() const { return _idle_windows; }
+    uint32_t getWindows() const { return _windows; }          // Windows tracked since boot
+    float getStepVariance() const { return _step_variance; }
+
+private:
+    float _variance;            // Noise variance estimate, counts^2
+    float _step_variance;       // Step-noise estimate, counts^2
+    uint32_t _idle_windows;     // Windows classified as noise only
+    uint32_t _windows;
+    bool _restored;             // Set from a saved floor
+
+    float threshold(uint32_t samples) const;
+};
+
+#endif
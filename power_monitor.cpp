@@ -1,184 +1,524 @@
 #include "power_monitor.h"
+#include <Preferences.h>
 
 PowerMonitor::PowerMonitor(uint8_t current_pin, uint8_t voltage_pin, uint8_t phase_count)
-    : _current_pin(current_pin), _voltage_pin(voltage_pin),
-      _phase_count(phase_count == THREE_PHASE ? THREE_PHASE : SINGLE_PHASE),
+    : _phase_count(phase_count == THREE_PHASE ? THREE_PHASE : SINGLE_PHASE),
+      _config(MeterConfig::of<DefaultMeter>()), _fixed_kernel(false), _window_cycles(0), _current_us(0),
       _voltage_dc(0), _voltage_ac(0), _current_ac(0),
-      _last_current(0), _filtered_offset(1880.0), _fast_offset(1880.0),
-      _last_valid_current(0), _power_w(0), _energy_kwh(0),
+      _last_current(0),
+      _last_valid_current(0), _power_w(0), _power_factor(1.0), _reactive_var(0),
       _last_energy_update(0), _last_valid_time(0),
-      _ct_connected(true), _in_reconnect(false),
-      _last_ct_state_change(0), _valid_reading_count(0) {
+      _in_reconnect(false), _sample_pin(current_pin), _applied_range(0xFF),
+      _voltage_gain(1.0), _voltage_offset(0), _cal_phase(PHASE_A), _range(), _reconstructed_current(0),
+      _over_range_power_w(0), _saturated_windows(0),
+      _learned_saved_ms(0), _have_saved_state(false), _warm(false),
+      _voltage_sequence(), _current_sequence(), _sequence_cycles(0),
+      _clock_base(0), _clock_millis(0), _rollups(NULL), _rollup_energy_mj(0),
+      _percentiles(NULL), _load_events(NULL), _anomalies(NULL),
+      _forecaster(NULL), _tariff(NULL), _snapshot(NULL), _window_count(0),
+      _bus(NULL), _load_events_seen(0), _anomalies_seen(0),
+      _pending_source(0), _pending_state(RECONFIG_IDLE), _reconfigures(0),
+      _timing(NULL), _stage_start_us(0) {
+    // Legacy three-phase construction has a CT on phase A only
+    for(uint8_t p = 0; p < PHASES; p++) {
+        _current_pins[p] = NO_PIN;
+        _voltage_pins[p] = NO_PIN;
+    }
+    _current_pins[PHASE_A] = current_pin;
+    _voltage_pins[PHASE_A] = voltage_pin;
+}
+
+PowerMonitor::PowerMonitor(const uint8_t current_pins[PHASES], const uint8_t voltage_pins[PHASES])
+    : PowerMonitor(current_pins[PHASE_A], voltage_pins[PHASE_A], THREE_PHASE) {
+    for(uint8_t p = PHASE_B; p < PHASES; p++) {
+        _current_pins[p] = current_pins[p];
+        _voltage_pins[p] = voltage_pins[p];
+    }
+}
+
+MonitorConfig MonitorConfig::single(uint8_t current_pin, uint8_t voltage_pin) {
+    MonitorConfig c;
+    c.phase_count = SINGLE_PHASE;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        c.current_pins[p] = NO_PIN;
+        c.voltage_pins[p] = NO_PIN;
+    }
+    c.current_pins[PHASE_A] = current_pin;
+    c.voltage_pins[PHASE_A] = voltage_pin;
+    c.meter = MeterConfig::of<DefaultMeter>();
+    return c;
+}
+
+MonitorConfig MonitorConfig::three(const uint8_t current_pins[PHASES], const uint8_t voltage_pins[PHASES]) {
+    MonitorConfig c;
+    c.phase_count = THREE_PHASE;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        c.current_pins[p] = current_pins[p];
+        c.voltage_pins[p] = voltage_pins[p];
+    }
+    c.meter = MeterConfig::of<DefaultMeter>();
+    return c;
 }
 
 void PowerMonitor::begin() {
-    pinMode(_current_pin, INPUT);
-    pinMode(_voltage_pin, INPUT);
+    uint8_t source;
+    takePendingConfig(source);  // Staged before begin(): nothing to carry over
     analogReadResolution(ADC_BITS);
     analogSetAttenuation(ADC_11db);
+    applyWiring();
+    loadCalibration();
+    updateScales();
+    if(_phase_count == SINGLE_PHASE) {
+        loadLearnedState();
+    }
+    _warm = false;
+    _window_count = 0;
+
     _last_energy_update = millis();
 }
 
-bool PowerMonitor::validateReading(int32_t adc_value) {
-    if (adc_value < MIN_VALID_ADC || adc_value > MAX_VALID_ADC) {
+void PowerMonitor::applyWiring() {
+    for(uint8_t p = 0; p < PHASES; p++) {
+        if(_current_pins[p] != NO_PIN) pinMode(_current_pins[p], INPUT);
+        if(_voltage_pins[p] != NO_PIN) pinMode(_voltage_pins[p], INPUT);
+    }
+
+    bool derived = _voltage_pins[PHASE_B] == NO_PIN || _voltage_pins[PHASE_C] == NO_PIN;
+    _three_phase.setDerivedVoltage(derived);
+    if(_phase_count == SINGLE_PHASE) {
+        _fixed_kernel = _config.samples == DefaultMeter::samples;
+    } else {
+        _fixed_kernel = _config.frames == DefaultMeter::frames &&
+                        wiredChannels(_voltage_pins) == DefaultMeter::voltage_channels &&
+                        wiredChannels(_current_pins) == DefaultMeter::current_channels;
+    }
+    _sample_pin = _current_pins[PHASE_A];
+    _applied_range = 0xFF;
+    if(_phase_count == SINGLE_PHASE) {
+        applyGainRange();
+    } else {
+        // Ranging is single-phase only: every CT reads the full 11 dB span
+        for(uint8_t p = 0; p < PHASES; p++) {
+            if(_current_pins[p] != NO_PIN) analogSetPinAttenuation(_current_pins[p], ADC_11db);
+        }
+    }
+    updateScales();
+}
+
+// Staging never waits: a config still READY is replaced, one being
+// written or applied makes the caller retry
+bool PowerMonitor::reconfigure(const MonitorConfig& config, uint8_t source) {
+    uint8_t state = _pending_state.load(std::memory_order_relaxed);
+    do {
+        if(state != RECONFIG_IDLE && state != RECONFIG_READY) return false;
+    } while(!_pending_state.compare_exchange_weak(state, RECONFIG_WRITING, std::memory_order_acquire));
+
+    _pending = config;
+    _pending_source = source;
+    _pending_state.store(RECONFIG_READY, std::memory_order_release);
+    return true;
+}
+
+bool PowerMonitor::takePendingConfig(uint8_t& source) {
+    uint8_t ready = RECONFIG_READY;
+    if(!_pending_state.compare_exchange_strong(ready, RECONFIG_APPLYING, std::memory_order_acquire)) {
         return false;
     }
+    MonitorConfig config = _pending;
+    source = _pending_source;
+    _pending_state.store(RECONFIG_IDLE, std::memory_order_release);
+
+    _phase_count = config.phase_count == THREE_PHASE ? THREE_PHASE : SINGLE_PHASE;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        _current_pins[p] = config.current_pins[p];
+        _voltage_pins[p] = config.voltage_pins[p];
+    }
+    _config = config.meter;
     return true;
 }
 
-bool PowerMonitor::checkCTStateChange(bool new_state) {
-    unsigned long now = millis();
-    if(new_state != _ct_connected && (now - _last_ct_state_change) > CT_STATE_DEBOUNCE) {
-        _last_ct_state_change = now;
-        return true;
+MonitorConfig PowerMonitor::getMonitorConfig() const {
+    MonitorConfig c;
+    c.phase_count = _phase_count;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        c.current_pins[p] = _current_pins[p];
+        c.voltage_pins[p] = _voltage_pins[p];
+    }
+    c.meter = _config;
+    return c;
+}
+
+// Accumulators (energy, demand, rollups, tariff) and the clock are not
+// touched: the next updateEnergy() integrates from the last one as usual
+void PowerMonitor::applyPendingConfig() {
+    MonitorConfig old = getMonitorConfig();
+    uint8_t source;
+    if(!takePendingConfig(source)) {
+        return;
+    }
+
+    bool rewired = old.phase_count != _phase_count ||
+                   memcmp(old.current_pins, _current_pins, sizeof(_current_pins)) != 0 ||
+                   memcmp(old.voltage_pins, _voltage_pins, sizeof(_voltage_pins)) != 0;
+    if(rewired) {
+        _three_phase = ThreePhaseMeter();
+        _voltage_sequence = SequenceComponents();
+        _current_sequence = SequenceComponents();
+        _reactive_var = 0;
+        _warm = false;          // Next valid window reseeds the smoothing
+        _in_reconnect = false;
+    }
+    if(old.phase_count != SINGLE_PHASE && _phase_count == SINGLE_PHASE) {
+        _ranger.reset(_ct_detector);    // Coarsest range is safe whatever the load did meanwhile
+    }
+    applyWiring();
+    if(_phase_count == SINGLE_PHASE && !_have_saved_state) {
+        loadLearnedState();     // Booted three-phase, so not loaded yet
+    }
+    if(_cal_phase >= _phase_count) {
+        _calibration.reset();
+    }
+    _reconfigures++;
+
+    if(_bus) {
+        Event event;
+        event.type = EVENT_CONFIG;
+        event.config.phase_count = _phase_count;
+        event.config.source = source;
+        _bus->publish(event, millis());
     }
-    return false;
 }
 
-void PowerMonitor::resetOffsetFilters() {
-    int32_t sum = 0;
-    int32_t min_val = 4095, max_val = 0;
-    _valid_reading_count = 0;
-    const int samples = 50;
+void PowerMonitor::setCurrentCalibration(uint8_t phase, const CalibrationTable& table) {
+    if(phase < PHASES) _current_cal[phase] = table;
+}
 
-    for(int i = 0; i < samples; i++) {
-        int32_t raw = analogRead(_current_pin);
-        sum += raw;
-        if(raw < min_val) min_val = raw;
-        if(raw > max_val) max_val = raw;
+// Tables live in NVS, one blob of points per phase
+bool PowerMonitor::loadCalibration() {
+    Preferences prefs;
+    if(!prefs.begin(CAL_NAMESPACE, true)) return false;
+
+    bool loaded = false;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        char key[] = "cur0";
+        key[3] += p;
+        CalibrationPoint points[MAX_CAL_POINTS];
+        size_t len = prefs.getBytesLength(key);
+        if(len == 0 || len > sizeof(points) || len % sizeof(CalibrationPoint) != 0) continue;
+        prefs.getBytes(key, points, len);
+        loaded |= _current_cal[p].setPoints(points, len / sizeof(CalibrationPoint));
+    }
+    if(prefs.isKey("vgain")) {
+        _voltage_gain = prefs.getFloat("vgain", 1.0);
+        _voltage_offset = prefs.getFloat("voff", 0);
+        loaded = true;
+    }
+    prefs.end();
+    return loaded;
+}
 
-        if(validateReading(raw)) {
-            _valid_reading_count++;
+bool PowerMonitor::saveCalibration() {
+    Preferences prefs;
+    if(!prefs.begin(CAL_NAMESPACE, false)) return false;
+
+    bool ok = true;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        char key[] = "cur0";
+        key[3] += p;
+        uint8_t count = _current_cal[p].getCount();
+        if(count == 0) {
+            prefs.remove(key);
         } else {
-            _valid_reading_count = 0;
+            size_t len = count * sizeof(CalibrationPoint);
+            ok &= prefs.putBytes(key, _current_cal[p].getPoints(), len) == len;
         }
-        delay(1);
     }
+    ok &= prefs.putFloat("vgain", _voltage_gain) == sizeof(float);
+    ok &= prefs.putFloat("voff", _voltage_offset) == sizeof(float);
+    prefs.end();
+    return ok;
+}
+
+void PowerMonitor::captureLearnedState(LearnedState& state) const {
+    memset(&state, 0, sizeof(state));
+    state.version = LEARN_VERSION;
+    state.ranges = _ranger.getCount();
+    uint8_t active = _ranger.getActive();
+    for(uint8_t r = 0; r < MAX_GAIN_RANGES; r++) {
+        // The active range's bias lives in the detector until a switch
+        bool learned = r == active || (r < _ranger.getCount() && _ranger.getRange(r).bias_learned);
+        state.bias[r] = r == active ? _ct_detector.getBias() : _ranger.getRange(r).bias;
+        state.noise_var[r] = _noise[r].getVariance();
+        if(learned) state.learned |= 1 << r;
+    }
+}
 
-    float quick_offset = sum / (float)samples;
+// A state saved with another range setup is ignored, not half-applied
+bool PowerMonitor::loadLearnedState() {
+    Preferences prefs;
+    if(!prefs.begin(LEARN_NAMESPACE, true)) return false;
 
-    if(quick_offset >= 1500 && quick_offset <= 2500 && _valid_reading_count >= MIN_VALID_COUNT) {
-        _filtered_offset = quick_offset;
-        _fast_offset = quick_offset;
-        _in_reconnect = true;
-        _ct_connected = true;
-    } else {
-        _ct_connected = false;
+    LearnedState state;
+    bool ok = prefs.getBytesLength("state") == sizeof(state) &&
+              prefs.getBytes("state", &state, sizeof(state)) == sizeof(state);
+    prefs.end();
+    if(!ok || state.version != LEARN_VERSION || state.ranges != _ranger.getCount()) {
+        return false;
     }
+
+    for(uint8_t r = 0; r < MAX_GAIN_RANGES; r++) {
+        _noise[r].setVariance(state.noise_var[r]);
+        if(state.learned & (1 << r)) {
+            _ranger.restoreBias(r, state.bias[r]);
+        }
+    }
+    uint8_t active = _ranger.getActive();
+    if(state.learned & (1 << active)) {
+        _ct_detector.setBias(state.bias[active]);
+    }
+    _saved_state = state;
+    _have_saved_state = true;
+    _learned_saved_ms = millis();
+    return true;
 }
 
-void PowerMonitor::calculateCurrent() {
-    unsigned long start_time = millis();
-    double sum_squared = 0;
-    int samples_taken = 0;
-    int valid_samples = 0;
-    int32_t raw_max = 0, raw_min = 4095;
-    double sum_raw = 0;
-
-    double pre_sum = 0;
-    const int pre_samples = 20;
-    _valid_reading_count = 0;
-
-    for(int i = 0; i < pre_samples; i++) {
-        int32_t raw = analogRead(_current_pin);
-        pre_sum += raw;
-        if(raw > raw_max) raw_max = raw;
-        if(raw < raw_min) raw_min = raw;
-
-        if(validateReading(raw)) {
-            _valid_reading_count++;
-        } else {
-            _valid_reading_count = 0;
+bool PowerMonitor::saveLearnedState() {
+    LearnedState state;
+    captureLearnedState(state);
+
+    Preferences prefs;
+    if(!prefs.begin(LEARN_NAMESPACE, false)) return false;
+    bool ok = prefs.putBytes("state", &state, sizeof(state)) == sizeof(state);
+    prefs.end();
+
+    if(ok) {
+        _saved_state = state;
+        _have_saved_state = true;
+        _learned_saved_ms = millis();
+    }
+    return ok;
+}
+
+void PowerMonitor::clearLearnedState() {
+    Preferences prefs;
+    if(prefs.begin(LEARN_NAMESPACE, false)) {
+        prefs.remove("state");
+        prefs.end();
+    }
+    _have_saved_state = false;
+}
+
+// NVS pages wear with every write, so a save needs both time and change
+void PowerMonitor::maybeSaveLearnedState() {
+    if(!_ct_detector.isConnected()) return;
+    if(_noise[_ranger.getActive()].getWindows() < LEARN_MIN_WINDOWS) return;
+
+    if(_have_saved_state) {
+        if(millis() - _learned_saved_ms < LEARN_SAVE_INTERVAL) return;
+
+        LearnedState state;
+        captureLearnedState(state);
+        bool changed = false;
+        for(uint8_t r = 0; r < MAX_GAIN_RANGES; r++) {
+            float old_var = _saved_state.noise_var[r];
+            changed |= fabsf(state.bias[r] - _saved_state.bias[r]) >= LEARN_BIAS_CHANGE;
+            changed |= fabsf(state.noise_var[r] - old_var) >= LEARN_NOISE_CHANGE * old_var;
+            changed |= (state.learned ^ _saved_state.learned) & (1 << r);
+        }
+        if(!changed) {
+            _learned_saved_ms = millis();   // Check again next interval
+            return;
         }
     }
-    float quick_check = pre_sum / pre_samples;
+    saveLearnedState();
+}
 
-    float disconnect_threshold = _ct_connected ? 
-                                CT_DISCONNECT_THRESHOLD : 
-                                CT_DISCONNECT_THRESHOLD - CT_HYSTERESIS;
+void PowerMonitor::updateScales() {
+    _three_phase.setScales(ADC_SCALE * VOLTAGE_DIVIDER_RATIO * _voltage_gain, _config.amps_per_count);
+}
 
-    bool possible_disconnect = (abs(quick_check - _filtered_offset) > disconnect_threshold) ||
-                             (_valid_reading_count < MIN_VALID_COUNT);
+// Channels wired from phase A up, or 0 if there is a gap
+uint8_t PowerMonitor::wiredChannels(const uint8_t pins[PHASES]) {
+    uint8_t count = 0;
+    while(count < PHASES && pins[count] != NO_PIN) count++;
+    for(uint8_t p = count; p < PHASES; p++) {
+        if(pins[p] != NO_PIN) return 0;
+    }
+    return count;
+}
 
-    if(possible_disconnect && checkCTStateChange(false)) {
-        Serial.println("CT disconnected - zero current");
-        _ct_connected = false;
-        _current_ac = 0;
-        _last_current = 0;
-        _last_valid_current = 0;
-        _in_reconnect = false;
-        return;
-    } else if(!possible_disconnect && !_ct_connected && checkCTStateChange(true)) {
-        Serial.println("CT reconnect detected - starting validation");
-        resetOffsetFilters();
+bool PowerMonitor::startCalibration(uint8_t phase, float ref_voltage, float ref_current, float ref_power) {
+    if(phase >= _phase_count) return false;
+    if(_calibration.isRunning() && phase != _cal_phase) return false;
+    if(_calibration.getStepCount() > 0 && phase != _cal_phase) {
+        _calibration.reset();   // A session covers one channel
+    }
+    _cal_phase = phase;
+    if(_phase_count == SINGLE_PHASE) {
+        ref_power = -1;         // No voltage waveform, so no power angle to compare
+    }
+    return _calibration.beginStep(ref_voltage, ref_current, ref_power, millis());
+}
+
+void PowerMonitor::feedCalibration(float voltage, float current, float power, float reactive) {
+    if(!_calibration.addWindow(voltage, current, power, reactive, millis())) {
         return;
     }
+    const CalibrationStep& step = _calibration.getStep(_calibration.getStepCount() - 1);
+    Serial.print("Calibration step "); Serial.print(_calibration.getStepCount());
+    Serial.print(step.converged ? " converged: " : " stopped: ");
+    Serial.print(step.windows); Serial.print(" windows, ");
+    Serial.print(step.duration_ms); Serial.print("ms, I ");
+    Serial.print(step.current, 4); Serial.print(" +/- ");
+    Serial.print(step.current_sem, 4); Serial.println("A");
+}
+
+// Replaces the channel's table with the solved points. Readings fed to the
+// solver were already corrected by the old table, so gains compose.
+bool PowerMonitor::applyCalibration(CalibrationResult& result) {
+    if(_calibration.isRunning() || !_calibration.solve(result)) {
+        return false;
+    }
 
-    double offset_sum = 0;
-    for(int i = 0; i < OFFSET_SAMPLES; i++) {
-        int32_t raw = analogRead(_current_pin);
-        offset_sum += raw;
+    CalibrationTable& table = _current_cal[_cal_phase];
+    CalibrationPoint points[CAL_MAX_STEPS];
+    for(uint8_t k = 0; k < result.points; k++) {
+        float gain, phase;
+        table.lookup(result.current[k], gain, phase);
+        points[k].current_a = result.current[k] / gain;
+        points[k].gain = gain * result.gain[k];
+        points[k].phase_deg = phase * RAD_TO_DEG + result.phase_deg[k];
+    }
+    table.clear();
+    for(uint8_t k = 0; k < result.points; k++) {
+        table.addPoint(points[k].current_a, points[k].gain, points[k].phase_deg);
     }
-    double current_offset = offset_sum / OFFSET_SAMPLES;
+    _voltage_gain = result.voltage_gain;
+    _voltage_offset = result.voltage_offset;
+    updateScales();
+    _calibration.reset();
+    return true;
+}
 
-    if(_in_reconnect) {
-        _fast_offset = (_fast_offset * 0.5) + (current_offset * 0.5);
-        _filtered_offset = (_filtered_offset * 0.8) + (current_offset * 0.2);
-    } else {
-        _fast_offset = (_fast_offset * (1.0 - FAST_FILTER)) + 
-                      (current_offset * FAST_FILTER);
-        _filtered_offset = (_filtered_offset * (1.0 - SLOW_FILTER)) + 
-                         (current_offset * SLOW_FILTER);
+void PowerMonitor::clearCalibration() {
+    for(uint8_t p = 0; p < PHASES; p++) {
+        _current_cal[p].clear();
     }
+    _voltage_gain = 1.0;
+    _voltage_offset = 0;
+    updateScales();
+    _calibration.reset();
+}
 
-    double effective_offset = (_fast_offset * 0.3) + (_filtered_offset * 0.7);
+int8_t PowerMonitor::addGainRange(uint8_t pin, adc_attenuation_t attenuation, float gain, float cal, float initial_bias) {
+    return _ranger.addRange(pin == NO_PIN ? _current_pins[PHASE_A] : pin, attenuation, gain, cal, initial_bias);
+}
 
-    for(int i = 0; i < SAMPLES_PER_CYCLE; i++) {
-        int32_t raw = analogRead(_current_pin);
-        if(raw > raw_max) raw_max = raw;
-        if(raw < raw_min) raw_min = raw;
-        sum_raw += raw;
+void PowerMonitor::applyGainRange() {
+    if(_ranger.getCount() == 0 || _ranger.getActive() == _applied_range) {
+        return;
+    }
+    const GainRange& range = _ranger.getRange(_ranger.getActive());
+    pinMode(range.pin, INPUT);
+    analogSetPinAttenuation(range.pin, (adc_attenuation_t)range.attenuation);
+    _sample_pin = range.pin;
+
+    if(_applied_range != 0xFF) {
+        Serial.print("Current range "); Serial.print(_ranger.getActive());
+        Serial.print(", gain x"); Serial.println(range.gain, 2);
+    }
+    _applied_range = _ranger.getActive();
+}
 
-        double centered = raw - effective_offset;
-        double squared = centered * centered;
+void PowerMonitor::calculateCurrent() {
+    // One pass feeds both the disconnect statistics and the RMS variance;
+    // noise is removed in quadrature instead of gating small samples out
+    _ct_detector.beginWindow();
+    uint8_t pin = _sample_pin;
+    unsigned long start_us = micros();
+    uint32_t start = ESP.getCycleCount();
+    if(_fixed_kernel) {
+        sampleWindow<DefaultMeter>(_ct_detector, [pin]() { return analogRead(pin); });
+    } else {
+        sampleWindow(_ct_detector, [pin]() { return analogRead(pin); }, _config.samples);
+    }
+    _window_cycles = ESP.getCycleCount() - start;
+    _current_us = micros() - start_us;
+    markStage(STAGE_ACQUIRE);
+    processCurrentWindow();
+}
 
-        if(squared > MIN_SQUARED_ADC) {
-            sum_squared += squared;
-            valid_samples++;
-        }
-        samples_taken++;
+void PowerMonitor::processCurrentWindow() {
+    // A range switch, and the settling after it, holds the last reading
+    if(!_ranger.endWindow(_ct_detector)) {
+        applyGainRange();
+        updateEnergy();
+        return;
+    }
+
+    NoiseFloor& noise = _noise[_ranger.getActive()];
+    uint8_t change = _ct_detector.endWindow(noise.getVariance());
+    if(change == CT_DISCONNECTED) {
+        Serial.print("CT disconnected - faults 0x");
+        Serial.println(_ct_detector.getFaults(), HEX);
+    } else if(change == CT_RECONNECTED) {
+        Serial.println("CT reconnect detected");
+        _in_reconnect = true;
     }
 
     float new_current = 0;
-    double peak_to_peak = raw_max - raw_min;
-    int pct_valid = (valid_samples * 100) / samples_taken;
     unsigned long now = millis();
+    bool connected = _ct_detector.isConnected();
+
+    uint32_t samples = _ct_detector.getSamples();
+    float variance = _ct_detector.getVariance();
+    bool valid_signal = noise.isSignal(variance, samples);
+    double rms_adc = noise.signalRms(variance, samples);
+    if(connected && _ct_detector.getFaults() == 0) {
+        float rate_hz = _current_us > 0 ? samples * 1000000.0f / _current_us : 0;
+        noise.update(variance, _ct_detector.getStepNoise(), samples,
+                     NoiseFloor::slewShare(getFrequencyHz(), rate_hz));
+        maybeSaveLearnedState();
+    }
 
-    bool valid_signal = (valid_samples >= MIN_VALID_SAMPLES) &&
-                       (peak_to_peak >= MIN_PEAK_TO_PEAK) &&
-                       (pct_valid >= MIN_PCT_VALID_SAMPLES);
-
-    if(_ct_connected && valid_signal) {
-        double rms_adc = sqrt(sum_squared / samples_taken);
-        double rms_voltage = rms_adc * ADC_SCALE;
-        double secondary_current = rms_voltage / CURRENT_BURDEN;
-        new_current = secondary_current * CT_TURNS * ICAL;
+    // Clipped peaks are restored from the share of samples at each rail
+    analyzeRange(_ct_detector, rms_adc, _range);
+    _reconstructed_current = 0;
+    _over_range_power_w = 0;
+
+    if(connected && valid_signal) {
+        new_current = rms_adc * _config.amps_per_count * _ranger.getScale();
+
+        // Single-phase has no voltage waveform, so only the gain applies
+        float cal_gain, cal_phase;
+        _current_cal[PHASE_A].lookup(new_current, cal_gain, cal_phase);
+        new_current *= cal_gain;
+        _reconstructed_current = new_current * _range.reconstructed_rms / rms_adc;
+
+        if(_range.saturated) {
+            _saturated_windows++;
+            _over_range_power_w = _voltage_ac * (_reconstructed_current - new_current);
+            Serial.print("ADC clipping: "); Serial.print(getClippedSamples());
+            Serial.print(" samples, est. "); Serial.print(_reconstructed_current, 1);
+            Serial.println("A");
+        }
 
-        if(_in_reconnect) {
+        if(!_warm) {
+            _current_ac = new_current;  // Restored floor: the first window is already accurate
+            _in_reconnect = false;
+        } else if(_in_reconnect) {
             _current_ac = (_last_current * 0.98) + (new_current * 0.02);
-            if(++samples_taken > 50) _in_reconnect = false;
+            _in_reconnect = false;
         } else {
-            _current_ac = (_last_current * SMOOTHING_FACTOR) + 
-                         (new_current * (1.0 - SMOOTHING_FACTOR));
+            _current_ac = (_last_current * _config.smoothing) +
+                         (new_current * (1.0 - _config.smoothing));
         }
 
         _last_current = _current_ac;
         _last_valid_current = new_current;
         _last_valid_time = now;
+        _warm = true;
     } else {
-        if(!_ct_connected) {
-            Serial.println("CT disconnected - zero current");
-        }
         _current_ac = 0;
         _last_current = 0;
         _last_valid_current = 0;
@@ -188,43 +528,315 @@ void PowerMonitor::calculateCurrent() {
     Serial.print("V, I: "); Serial.print(_current_ac, 2);
     Serial.println("A");
 
+    if(_calibration.isRunning()) {
+        float voltage = (_voltage_ac - _voltage_offset) / _voltage_gain;
+        feedCalibration(voltage, new_current, voltage * new_current, 0);
+    }
     updateEnergy();
 }
 
 void PowerMonitor::updateEnergy() {
-    unsigned long now = millis();
-    float elapsed_hours = (now - _last_energy_update) / 3600000.0;
+    markStage(STAGE_DSP);
+    uint32_t now = millis();
+    uint32_t elapsed_ms = now - _last_energy_update;  // Wrap-safe across millis() rollover
 
-    if (_phase_count == THREE_PHASE) {
-        _power_w = THREE_PHASE_FACTOR * _voltage_ac * _current_ac;
-    } else {
+    // Three-phase power is already the sum of per-phase real power
+    if (_phase_count == SINGLE_PHASE) {
         _power_w = _voltage_ac * _current_ac;
     }
+    _power_factor = calculatePowerFactor();
 
-    _energy_kwh += (_power_w * elapsed_hours * WH_TO_KWH);
+    _energy.add(_power_w, elapsed_ms);
+    if (_over_range_power_w > 0) {
+        _over_range.add(_over_range_power_w, elapsed_ms);
+    }
+    _demand.addEnergy(getUnixTime(), _power_w * (elapsed_ms / MS_PER_HOUR));
+    if (_tariff) {
+        _tariff->addEnergy(getUnixTime(), _power_w, elapsed_ms);
+    }
     _last_energy_update = now;
+
+    if (_rollups) {
+        int64_t energy_mj = _energy.getMilliJoules();
+        float delta_wh = (energy_mj - _rollup_energy_mj) / (MJ_PER_KWH / 1000.0);
+        uint8_t closed = _rollups->add(getUnixTime(), _voltage_ac, _current_ac, _power_w, delta_wh);
+        _rollup_energy_mj = energy_mj;
+
+        RollupBucket hour;
+        if (_forecaster && (closed & (1 << ROLLUP_HOUR)) && _rollups->getBucket(ROLLUP_HOUR, 0, hour)) {
+            _forecaster->addHour(hour.start, hour.energy_wh);
+        }
+    }
+
+    if (_percentiles) {
+        _percentiles->add(getUnixTime(), _current_ac, _power_w);
+    }
+
+    if (_load_events) {
+        // Smoothed single-phase current would smear steps over many windows
+        float step_power = (_phase_count == SINGLE_PHASE) ?
+                           _voltage_ac * _last_valid_current : _power_w;
+        _load_events->update(getUnixTime(), step_power, _reactive_var, _phase_count == THREE_PHASE);
+    }
+
+    if (_anomalies) {
+        _anomalies->update(getUnixTime(), _voltage_ac, _current_ac, _power_w);
+    }
+    markStage(STAGE_ENERGY);
+}
+
+bool PowerMonitor::getNextHourForecast(float& wh, float& band_wh) const {
+    if (!_forecaster || !_forecaster->isCurrent(getUnixTime())) {
+        return false;
+    }
+    wh = _forecaster->forecastNextHourWh(getUnixTime(), band_wh);
+    return true;
+}
+
+bool PowerMonitor::getEndOfDayForecast(float& kwh, float& band_kwh) const {
+    if (!_rollups || !_forecaster || !_forecaster->isCurrent(getUnixTime())) {
+        return false;
+    }
+
+    float today_wh = _rollups->getOpenEnergyWh(ROLLUP_DAY);
+    float hour_wh = _rollups->getOpenEnergyWh(ROLLUP_HOUR);
+
+    float band_wh;
+    float rest_wh = _forecaster->forecastRestOfDayWh(getUnixTime(), hour_wh, band_wh);
+    kwh = (today_wh + rest_wh) / 1000.0;
+    band_kwh = band_wh / 1000.0;
+    return true;
+}
+
+void PowerMonitor::syncClock(uint32_t unix_time) {
+    _clock_base = unix_time;
+    _clock_millis = millis();
+}
+
+uint32_t PowerMonitor::getUnixTime() const {
+    return _clock_base + (millis() - _clock_millis) / 1000;
 }
 
 void PowerMonitor::sampleVoltage() {
     uint32_t sum = 0;
-    const int samples = 100;
-    for(int i = 0; i < samples; i++) {
-        sum += analogRead(_voltage_pin);
+    for(int i = 0; i < VOLTAGE_SAMPLES; i++) {
+        sum += analogRead(_voltage_pins[PHASE_A]);
     }
-    float base_voltage = (sum / samples) * ADC_SCALE * 101.70;
+    setVoltage(sum);
+}
 
-    if (_phase_count == THREE_PHASE) {
-        _voltage_ac = base_voltage * THREE_PHASE_FACTOR;
+void PowerMonitor::setVoltage(uint32_t sum) {
+    _voltage_ac = (sum / VOLTAGE_SAMPLES) * ADC_SCALE * VOLTAGE_DIVIDER_RATIO * _voltage_gain + _voltage_offset;
+}
+
+SamplePlan PowerMonitor::getSamplePlan() const {
+    SamplePlan plan = {NO_PIN, NO_PIN, 0};
+    if(_phase_count == SINGLE_PHASE) {
+        plan.current_pin = _sample_pin;
+        plan.voltage_pin = _voltage_pins[PHASE_A];
+        plan.range = _ranger.getActive();
+    }
+    return plan;
+}
+
+void PowerMonitor::acquireFrame(const SamplePlan& plan, SampleFrame& frame) {
+    frame.range = plan.range;
+    frame.start_us = micros();
+    frame.voltage_sum = 0;
+    for(int i = 0; i < VOLTAGE_SAMPLES; i++) {
+        frame.voltage_sum += analogRead(plan.voltage_pin);
+    }
+    for(uint16_t i = 0; i < FRAME_SAMPLES; i++) {
+        frame.current[i] = analogRead(plan.current_pin);
+    }
+    frame.count = FRAME_SAMPLES;
+    frame.duration_us = micros() - frame.start_us;
+}
+
+bool PowerMonitor::processFrame(const SampleFrame& frame) {
+    applyPendingConfig();
+    _stage_start_us = micros();
+    if(_phase_count != SINGLE_PHASE || frame.range != _ranger.getActive()) {
+        return false;
+    }
+
+    setVoltage(frame.voltage_sum);
+    // The voltage reads come first in the frame and take their share of its time
+    _current_us = frame.duration_us * frame.count / (frame.count + VOLTAGE_SAMPLES);
+    _ct_detector.beginWindow();
+    for(uint16_t i = 0; i < frame.count; i++) {
+        _ct_detector.addSample(frame.current[i]);
+    }
+    processCurrentWindow();
+    _window_count++;
+    publishWindow();
+    return true;
+}
+
+void PowerMonitor::calculateThreePhase() {
+    // One stream: Va, Ia, Vb, Ib, Vc, Ic per frame keeps the channels
+    // within a few conversions of each other
+    _three_phase.beginWindow();
+    unsigned long start_us = micros();
+    uint32_t start = ESP.getCycleCount();
+    if(_fixed_kernel) {
+        sampleFrames<DefaultMeter>(_three_phase, _voltage_pins, _current_pins,
+                                   [](uint8_t pin) { return analogRead(pin); });
+    } else {
+        sampleFrames(_three_phase, _voltage_pins, _current_pins,
+                     [](uint8_t pin) { return analogRead(pin); }, _config.frames);
+    }
+    _window_cycles = ESP.getCycleCount() - start;
+    markStage(STAGE_ACQUIRE);
+    _three_phase.endWindow(micros() - start_us, _current_cal);
+    calculateSequence();
+
+    float voltage_sum = 0, current_sum = 0;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        voltage_sum += _three_phase.getPhase(p).voltage_v;
+        current_sum += _three_phase.getPhase(p).current_a;
+    }
+    _voltage_ac = voltage_sum / PHASES;
+    _current_ac = current_sum / PHASES;
+    _power_w = _three_phase.getTotalPowerW();
+
+    // Q = Im(V * conj(I)) of the fundamental, summed over phases
+    _reactive_var = 0;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        const Phasor& v = _three_phase.getVoltagePhasor(p);
+        const Phasor& i = _three_phase.getCurrentPhasor(p);
+        _reactive_var += v.im * i.re - v.re * i.im;
+    }
+
+    Serial.print("V: "); Serial.print(_voltage_ac, 1);
+    Serial.print("V, I: "); Serial.print(_current_ac, 2);
+    Serial.print("A, In: "); Serial.print(_three_phase.getNeutralCurrentA(), 2);
+    Serial.print("A, Unb: "); Serial.print(_three_phase.getCurrentUnbalancePct(), 1);
+    Serial.print("%, V2/V1: ");
+    if(hasVoltageUnbalance()) {
+        Serial.print(_voltage_sequence.negative_ratio, 2);
+        Serial.print("%");
     } else {
-        _voltage_ac = base_voltage;
+        Serial.print("n/a");    // Derived B/C are balanced by construction
+    }
+    Serial.print(", I2/I1: "); Serial.print(_current_sequence.negative_ratio, 1);
+    Serial.print("%, "); Serial.print(_three_phase.getFrameRateHz(), 0);
+    Serial.println(" frames/s");
+
+    if(_calibration.isRunning()) {
+        const PhaseReading& r = _three_phase.getPhase(_cal_phase);
+        const Phasor& v = _three_phase.getVoltagePhasor(_cal_phase);
+        const Phasor& i = _three_phase.getCurrentPhasor(_cal_phase);
+        feedCalibration(r.voltage_v / _voltage_gain, r.current_a, r.power_w, v.im * i.re - v.re * i.im);
+    }
+    updateEnergy();
+}
+
+void PowerMonitor::calculateSequence() {
+    Phasor voltages[PHASES], currents[PHASES];
+    for(uint8_t p = 0; p < PHASES; p++) {
+        voltages[p] = _three_phase.getVoltagePhasor(p);
+        currents[p] = _three_phase.getCurrentPhasor(p);
     }
+
+    uint32_t start = ESP.getCycleCount();
+    computeSequence(voltages, _voltage_sequence);
+    computeSequence(currents, _current_sequence);
+    _sequence_cycles = ESP.getCycleCount() - start;
+}
+
+bool PowerMonitor::isSinglePhasing() const {
+    return _current_sequence.positive_mag >= MIN_SEQUENCE_CURRENT &&
+           _current_sequence.negative_ratio >= SINGLE_PHASING_RATIO;
 }
 
 void PowerMonitor::update() {
-    sampleVoltage();
-    calculateCurrent();
+    applyPendingConfig();
+    _stage_start_us = micros();
+    if (_phase_count == THREE_PHASE) {
+        calculateThreePhase();
+    } else {
+        sampleVoltage();
+        calculateCurrent();
+    }
+    _window_count++;
+    publishWindow();
+}
+
+void PowerMonitor::publishWindow() {
+    if (!_snapshot && !_bus) {
+        return;
+    }
+
+    Measurement m;
+    memset(&m, 0, sizeof(m));
+    m.window = _window_count;
+    m.unix_time = getUnixTime();
+    m.voltage_v = _voltage_ac;
+    m.current_a = _current_ac;
+    m.power_w = _power_w;
+    m.power_factor = _power_factor;
+    m.energy_kwh = _energy.getKWh();
+    if (_phase_count == THREE_PHASE) m.flags |= MEAS_THREE_PHASE | MEAS_CT_CONNECTED;
+    else if (_ct_detector.isConnected()) m.flags |= MEAS_CT_CONNECTED;
+    if (_range.saturated) m.flags |= MEAS_SATURATED;
+    if (_calibration.isRunning()) m.flags |= MEAS_CALIBRATING;
+    if (isAboveMWhThreshold()) m.flags |= MEAS_ABOVE_MWH;
+    if (getNextHourForecast(m.next_hour_wh, m.next_hour_band_wh) &&
+        getEndOfDayForecast(m.day_kwh, m.day_band_kwh)) {
+        m.flags |= MEAS_FORECAST;
+    }
+    if (_snapshot) {
+        _snapshot->publish(m);
+    }
+    if (!_bus) {
+        return;
+    }
+
+    uint32_t now = millis();
+    Event event;
+    event.type = EVENT_WINDOW;
+    event.window = m;
+    _bus->publish(event, now);
+
+    // Detector rings hold the newest events; publish unseen ones oldest first
+    if (_load_events) {
+        uint32_t unseen = _load_events->getTotalEvents() - _load_events_seen;
+        if (unseen > _load_events->getEventCount()) unseen = _load_events->getEventCount();
+        event.type = EVENT_LOAD;
+        while (unseen > 0 && _load_events->getEvent(--unseen, event.load)) {
+            _bus->publish(event, now);
+        }
+        _load_events_seen = _load_events->getTotalEvents();
+    }
+    if (_anomalies) {
+        uint32_t unseen = _anomalies->getTotalEvents() - _anomalies_seen;
+        if (unseen > _anomalies->getEventCount()) unseen = _anomalies->getEventCount();
+        event.type = EVENT_ANOMALY;
+        while (unseen > 0 && _anomalies->getEvent(--unseen, event.anomaly)) {
+            _bus->publish(event, now);
+        }
+        _anomalies_seen = _anomalies->getTotalEvents();
+    }
+}
+
+void PowerMonitor::markStage(uint8_t stage) {
+    if (!_timing) {
+        return;
+    }
+    uint32_t now = micros();
+    _timing->record(stage, now - _stage_start_us);
+    _stage_start_us = now;
 }
 
 float PowerMonitor::calculatePowerFactor() {
-    return 1.0;  // Placeholder for future implementation
+    if (_phase_count == SINGLE_PHASE) {
+        return 1.0;  // Single-phase voltage is not sampled as a waveform
+    }
+
+    float apparent = 0;
+    for(uint8_t p = 0; p < PHASES; p++) {
+        apparent += _three_phase.getPhase(p).voltage_v * _three_phase.getPhase(p).current_a;
+    }
+    return apparent > 0 ? _power_w / apparent : 0;
 }
@@ -2,6 +2,27 @@
 #define POWER_MONITOR_H
 
 #include <Arduino.h>
+#include <atomic>
+#include "three_phase.h"
+#include "sequence.h"
+#include "demand_meter.h"
+#include "energy_accumulator.h"
+#include "rollup_store.h"
+#include "quantile_sketch.h"
+#include "load_events.h"
+#include "anomaly_detector.h"
+#include "forecaster.h"
+#include "tariff.h"
+#include "noise_floor.h"
+#include "ct_detector.h"
+#include "range_diagnostics.h"
+#include "gain_ranger.h"
+#include "calibration_table.h"
+#include "calibration_solver.h"
+#include "sample_kernel.h"
+#include "measurement_snapshot.h"
+#include "event_bus.h"
+#include "stage_timing.h"
 
 // ADC Configuration for ESP32
 #define ADC_BITS        12      // ESP32 ADC resolution (12-bit gives 0-4095 range)
@@ -12,78 +33,340 @@
 // Current Measurement Constants
 #define CURRENT_BURDEN  10.0    // CT burden resistor value in ohms - must match hardware
 #define CT_TURNS        1000    // CT turns ratio for OPCT10ATL-1000
-#define ICAL            0.963   // Calibrated for 77A test load
+#define ICAL            0.963   // Calibrated for 77A test load; tables refine it per current
 #define SAMPLES_PER_CYCLE 1480  // Number of samples for accurate RMS calculation
 
-// Validation Constants
-#define OFFSET_SAMPLES   100    // Increased samples for better stability
-#define FAST_FILTER     0.50    // Very fast response during recalibration
-#define SLOW_FILTER     0.02    // Very slow filter for stability
-#define MIN_SQUARED_ADC 100.0   // Reduced for better sensitivity
-#define MIN_VALID_SAMPLES 200   // Balance between stability and responsiveness
-#define MIN_PEAK_TO_PEAK 40.0   // Reduced for motor loads
-#define MIN_PCT_VALID_SAMPLES 15 // More permissive for inductive loads
-#define SMOOTHING_FACTOR 0.95   // Strong smoothing for stability
+// Calibration Storage
+#define CAL_NAMESPACE "calib"   // NVS namespace of calibration tables
+
+// Learned Channel State
+#define LEARN_NAMESPACE "learned"   // NVS namespace of bias and noise floor
+#define LEARN_VERSION 1             // Bump when LearnedState changes layout
+#define LEARN_MIN_WINDOWS 50        // Tracked windows before the first save
+#define LEARN_SAVE_INTERVAL 3600000 // Minimum ms between saves (flash wear)
+#define LEARN_BIAS_CHANGE 2.0       // Bias counts that justify a new save
+#define LEARN_NOISE_CHANGE 0.25     // Relative noise variance change that justifies a save
 
-// Reconnection Detection
-#define CT_DISCONNECT_THRESHOLD 4000  // Increased threshold for better stability
-#define CT_STATE_DEBOUNCE 5000      // 5 second debounce for CT state changes
-#define CT_HYSTERESIS 2000         // Larger hysteresis band to prevent oscillation
-#define MIN_VALID_ADC 400         // More permissive minimum ADC value
-#define MAX_VALID_ADC 3600        // More permissive maximum ADC value
-#define MIN_VALID_COUNT 5         // Reduced minimum valid readings for better stability
+// Single-phase current channel state restored at boot, per gain range
+struct LearnedState {
+    uint8_t version;
+    uint8_t ranges;             // Gain ranges configured when saved
+    uint8_t learned;            // Bit per range with a learned bias
+    float bias[MAX_GAIN_RANGES];      // Counts
+    float noise_var[MAX_GAIN_RANGES]; // Counts^2
+};
+
+// Current Smoothing
+#define SMOOTHING_FACTOR 0.95   // Strong smoothing for stability
 
 // Energy Constants
 #define ENERGY_UPDATE_INTERVAL 1000 // Update energy calculation every 1 second
-#define WH_TO_KWH 0.001      // Convert Watt-hours to kWh
+#define MS_PER_HOUR 3600000.0  // Milliseconds per hour
 #define KWH_TO_MWH 0.001     // Convert kWh to MWh
 #define MWH_THRESHOLD 1000.0  // Threshold for converting to MWh
 
+// Voltage Measurement
+#define VOLTAGE_DIVIDER_RATIO 101.70 // Calibrated divider ratio (ADC volts to line volts)
+#define VOLTAGE_SAMPLES 100      // Samples averaged for single-phase voltage
+
+// Split Acquisition
+#define FRAME_SAMPLES SAMPLES_PER_CYCLE // Current samples per frame
+
+// What a sampling task reads for the next frame, packed into one word so
+// it can be handed over atomically. current_pin NO_PIN: nothing to sample.
+struct SamplePlan {
+    uint8_t current_pin;
+    uint8_t voltage_pin;
+    uint8_t range;              // Gain range the pin is set up for
+
+    uint32_t pack() const { return current_pin | (voltage_pin << 8) | ((uint32_t)range << 16); }
+    static SamplePlan unpack(uint32_t word) {
+        SamplePlan p = {(uint8_t)word, (uint8_t)(word >> 8), (uint8_t)(word >> 16)};
+        return p;
+    }
+};
+
+// One single-phase window of raw samples
+struct SampleFrame {
+    uint32_t sequence;          // Frames produced before this one
+    uint32_t start_us;
+    uint32_t duration_us;
+    uint32_t voltage_sum;       // VOLTAGE_SAMPLES voltage readings summed
+    uint8_t range;              // SamplePlan::range when sampled
+    uint16_t count;             // Valid entries in current
+    int16_t current[FRAME_SAMPLES];
+};
+
 // Phase Configuration
 #define SINGLE_PHASE 1
 #define THREE_PHASE  3
-#define THREE_PHASE_FACTOR 1.732 // √3 for three-phase power calculations
+
+// The build's front end. Its acquisition loops are compiled for this window
+// length and wiring; a MeterConfig or pins that differ use the runtime
+// loops instead. The scale and smoothing are the MeterConfig defaults.
+struct DefaultMeter {
+    static constexpr uint16_t samples = SAMPLES_PER_CYCLE;
+    static constexpr uint16_t frames = THREE_PHASE_FRAMES;
+    static constexpr uint8_t voltage_channels = 1;  // B/C derived from phase A
+    static constexpr uint8_t current_channels = PHASES;
+    static constexpr float amps_per_count = ADC_SCALE / CURRENT_BURDEN * CT_TURNS * ICAL;
+    static constexpr float smoothing = SMOOTHING_FACTOR;
+};
+
+// Hot Reconfiguration
+#define RECONFIG_IDLE     0     // Nothing staged
+#define RECONFIG_WRITING  1     // reconfigure() is copying a config in
+#define RECONFIG_READY    2     // Staged, applied at the next window boundary
+#define RECONFIG_APPLYING 3     // Owner is taking it
+
+// Wiring and front end of a monitor, replaced as a whole by reconfigure()
+struct MonitorConfig {
+    uint8_t phase_count;                // SINGLE_PHASE or THREE_PHASE
+    uint8_t current_pins[PHASES];       // Phase A first, NO_PIN if not wired
+    uint8_t voltage_pins[PHASES];
+    MeterConfig meter;
+
+    static MonitorConfig single(uint8_t current_pin, uint8_t voltage_pin);
+    static MonitorConfig three(const uint8_t current_pins[PHASES], const uint8_t voltage_pins[PHASES]);
+};
 
 class PowerMonitor {
 public:
     PowerMonitor(uint8_t current_pin, uint8_t voltage_pin, uint8_t phase_count = SINGLE_PHASE);
+    // Three-phase with one CT per phase. Voltage pins B/C may be NO_PIN, in
+    // which case they are derived from phase A shifted by 120/240 degrees.
+    PowerMonitor(const uint8_t current_pins[PHASES], const uint8_t voltage_pins[PHASES]);
     void begin();
     void update();
+
+    // Split single-phase mode: a sampling task fills frames from
+    // getSamplePlan() with acquireFrame() (no monitor state touched), and
+    // the task owning the monitor runs processFrame() instead of update().
+    // Frames sampled in a range that is no longer active are dropped.
+    SamplePlan getSamplePlan() const;
+    static void acquireFrame(const SamplePlan& plan, SampleFrame& frame);
+    bool processFrame(const SampleFrame& frame);
+
+    // Front-end constants, DefaultMeter unless set before begin()
+    void setConfig(const MeterConfig& config) { _config = config; }
+    const MeterConfig& getConfig() const { return _config; }
+    bool isFixedKernel() const { return _fixed_kernel; }    // Compiled-in loops in use
+
+    // Any task may stage new wiring; the owner applies it at the next window
+    // boundary (start of update() or processFrame(), or in begin()), so a
+    // window is never sampled half in each mode. Energy, demand, history,
+    // calibration, gain ranges and learned bias/noise carry over; the
+    // smoothing filter and three-phase DSP restart when the wiring changes.
+    // Publishes EVENT_CONFIG with source when applied. Returns false if
+    // another task is staging or the owner is applying at that moment.
+    bool reconfigure(const MonitorConfig& config, uint8_t source = 0);
+    bool isReconfigurePending() const { return _pending_state.load() != RECONFIG_IDLE; }
+    MonitorConfig getMonitorConfig() const;     // Owner task only
+    uint32_t getReconfigureCount() const { return _reconfigures; }
+    uint32_t getWindowCycles() const { return _window_cycles; } // CPU cycles of the last acquisition
     float getVoltageAC() const { return _voltage_ac; }
     float getCurrentAC() const { return _current_ac; }
     float getPowerW() const { return _power_w; }
-    float getEnergyKWh() const { return _energy_kwh; }
-    float getEnergyMWh() const { return _energy_kwh * KWH_TO_MWH; }
-    bool isAboveMWhThreshold() const { return _energy_kwh >= MWH_THRESHOLD; }
+    float getEnergyKWh() const { return _energy.getKWh(); }
+    float getEnergyMWh() const { return _energy.getKWh() * KWH_TO_MWH; }
+    bool isAboveMWhThreshold() const { return _energy.getKWh() >= MWH_THRESHOLD; }
+    int64_t getEnergyMilliJoules() const { return _energy.getMilliJoules(); }
     uint8_t getPhaseCount() const { return _phase_count; }
+    const NoiseFloor& getNoiseFloor() const { return _noise[_ranger.getActive()]; } // Single-phase current channel
+    const CtDetector& getCtDetector() const { return _ct_detector; }
+    bool isCtConnected() const { return _ct_detector.isConnected(); }
+
+    // Single-phase ADC range use; currents are unsmoothed window values
+    const RangeDiagnostics& getRangeDiagnostics() const { return _range; }
+    uint32_t getClippedSamples() const { return _range.clipped_low + _range.clipped_high; }
+    bool isSaturated() const { return _range.saturated; }
+    float getReconstructedCurrentA() const { return _reconstructed_current; }
+    float getOverRangeEnergyKWh() const { return _over_range.getKWh(); } // Energy missed while clipped
+    uint32_t getSaturatedWindows() const { return _saturated_windows; }
+
+    // Single-phase gain ranging; add the coarsest (11 dB) range and any finer
+    // ones before begin(). Gain is counts per coarse-range count, pin NO_PIN
+    // means the current pin. Without ranges the current pin stays at 11 dB.
+    int8_t addGainRange(uint8_t pin, adc_attenuation_t attenuation, float gain, float cal, float initial_bias);
+    const GainRanger& getGainRanger() const { return _ranger; }
+
+    // Per-phase CT gain/phase against current, applied once per window.
+    // begin() loads tables saved in NVS over any set before it.
+    void setCurrentCalibration(uint8_t phase, const CalibrationTable& table);
+    const CalibrationTable& getCurrentCalibration(uint8_t phase) const { return _current_cal[phase < PHASES ? phase : PHASE_A]; }
+    bool loadCalibration();
+    bool saveCalibration();
+
+    // Learned CT bias and noise floor survive reboots, so readings are
+    // accurate from the first window. Saved from update() when they have
+    // moved, at most once per LEARN_SAVE_INTERVAL.
+    bool loadLearnedState();
+    bool saveLearnedState();
+    void clearLearnedState();
+
+    // Guided calibration: one step per reference load on one channel
+    // (ref_power < 0 if unknown), then applyCalibration() and saveCalibration()
+    bool startCalibration(uint8_t phase, float ref_voltage, float ref_current, float ref_power = -1);
+    bool isCalibrating() const { return _calibration.isRunning(); }
+    void abortCalibration() { _calibration.abortStep(); }
+    const CalibrationSolver& getCalibration() const { return _calibration; }
+    bool applyCalibration(CalibrationResult& result);
+    void clearCalibration();
+    float getVoltageGain() const { return _voltage_gain; }
+    float getPowerFactor() const { return _power_factor; }
+    float getReactivePowerVar() const { return _reactive_var; } // Fundamental Q, three-phase only
+
+    // Three-phase readings (zero in single-phase mode)
+    const PhaseReading& getPhase(uint8_t phase) const { return _three_phase.getPhase(phase); }
+    float getNeutralCurrentA() const { return _three_phase.getNeutralCurrentA(); }
+    float getVoltageUnbalancePct() const { return _three_phase.getVoltageUnbalancePct(); }
+    float getCurrentUnbalancePct() const { return _three_phase.getCurrentUnbalancePct(); }
+    float getFrequencyHz() const { return _three_phase.getFrequencyHz(); }
+    float getFrameRateHz() const { return _three_phase.getFrameRateHz(); }
+
+    // Symmetrical components, updated once per three-phase window
+    const SequenceComponents& getVoltageSequence() const { return _voltage_sequence; }
+    const SequenceComponents& getCurrentSequence() const { return _current_sequence; }
+    bool hasVoltageUnbalance() const { return !_three_phase.isVoltageDerived(); } // False with derived B/C
+    bool isVoltageUnbalanced() const { return hasVoltageUnbalance() && _voltage_sequence.negative_ratio > VOLTAGE_UNBALANCE_LIMIT; }
+    bool isSinglePhasing() const;
+    uint32_t getSequenceCycles() const { return _sequence_cycles; }
+
+    // Wall clock for timestamps, seconds since epoch (uptime until synced)
+    void syncClock(uint32_t unix_time);
+    uint32_t getUnixTime() const;
+
+    // Demand metering
+    DemandMeter& getDemand() { return _demand; }
+    const DemandMeter& getDemand() const { return _demand; }
+
+    // In-RAM history, fed once per window when attached
+    void setRollupStore(RollupStore* store) { _rollups = store; }
+    RollupStore* getRollupStore() const { return _rollups; }
+
+    // Daily current/power percentiles, fed once per window when attached
+    void setPercentiles(DailyPercentiles* percentiles) { _percentiles = percentiles; }
+    DailyPercentiles* getPercentiles() const { return _percentiles; }
+
+    // Appliance step detection on unsmoothed per-window P/Q when attached.
+    // Single-phase has no voltage waveform, so events carry dQ = 0 there.
+    void setLoadEventDetector(LoadEventDetector* detector) { _load_events = detector; }
+    LoadEventDetector* getLoadEventDetector() const { return _load_events; }
+
+    // Streaming anomaly detection on every window when attached
+    void setAnomalyDetector(AnomalyDetector* detector) { _anomalies = detector; }
+    AnomalyDetector* getAnomalyDetector() const { return _anomalies; }
+
+    // Hourly energy forecast, fed from closed hour rollups (needs a RollupStore)
+    void setForecaster(EnergyForecaster* forecaster) { _forecaster = forecaster; }
+    EnergyForecaster* getForecaster() const { return _forecaster; }
+    bool getNextHourForecast(float& wh, float& band_wh) const;   // The hour after the open one
+    bool getEndOfDayForecast(float& kwh, float& band_kwh) const;
+
+    // Time-of-use energy and cost registers, fed on every energy update
+    void setTariff(TariffEngine* tariff) { _tariff = tariff; }
+    TariffEngine* getTariff() const { return _tariff; }
+
+    // Consistent copy of each window's readings for other tasks, published
+    // at the end of update() when attached
+    void setSnapshot(MeasurementSnapshot* snapshot) { _snapshot = snapshot; }
+    MeasurementSnapshot* getSnapshot() const { return _snapshot; }
+    uint32_t getWindowCount() const { return _window_count; }
+
+    // Window measurements and new load/anomaly events, published once per
+    // window when attached
+    void setEventBus(EventBus* bus) { _bus = bus; }
+    EventBus* getEventBus() const { return _bus; }
+
+    // Acquire, DSP and energy stage durations of each window when attached;
+    // split mode's sampling task records its own acquire stage
+    void setStageTiming(StageTiming* timing) { _timing = timing; }
+    StageTiming* getStageTiming() const { return _timing; }
 
 private:
-    uint8_t _current_pin;       // ADC pin for current sensor
-    uint8_t _voltage_pin;       // ADC pin for voltage measurement
+    uint8_t _current_pins[PHASES]; // ADC pins for current sensors (phase A first)
+    uint8_t _voltage_pins[PHASES]; // ADC pins for voltage measurement
     uint8_t _phase_count;       // Number of phases (1 or 3)
+    MeterConfig _config;        // Window lengths and scales
+    bool _fixed_kernel;         // _config and pins match DefaultMeter
+    uint32_t _window_cycles;    // CPU cycles spent acquiring the last window
+    uint32_t _current_us;       // Time spent sampling the single-phase current channel
     float _voltage_dc;          // Raw DC voltage reading
     float _voltage_ac;          // Calculated AC voltage
     float _current_ac;          // Calculated AC current in amps
     float _last_current;        // Previous current reading for smoothing
-    float _filtered_offset;     // Slow filtered offset
-    float _fast_offset;         // Fast filtered offset
     float _last_valid_current;  // Last known valid current
     float _power_w;            // Real power in watts
-    float _energy_kwh;         // Accumulated energy in kilowatt-hours
-    unsigned long _last_energy_update; // Timestamp for energy updates
+    float _power_factor;       // Total power factor
+    float _reactive_var;       // Fundamental reactive power
+    EnergyAccumulator _energy; // Accumulated energy, exact milli-joules
+    uint32_t _last_energy_update; // millis() of last energy update
     unsigned long _last_valid_time;   // Timestamp of last valid reading
-    bool _ct_connected;        // CT connection state tracking
     bool _in_reconnect;        // Flag for reconnection state
-    unsigned long _last_ct_state_change; // Timestamp of last CT state change
-    uint8_t _valid_reading_count;      // Counter for consecutive valid readings
+    CtDetector _ct_detector;           // Single-phase CT presence and window stats
+    GainRanger _ranger;                // Current channel input ranges
+    uint8_t _sample_pin;               // Pin of the active range
+    uint8_t _applied_range;            // Range whose attenuation is set, 0xFF if none
+    CalibrationTable _current_cal[PHASES]; // CT gain/phase tables, phase A is single-phase
+    float _voltage_gain;               // Calibrated voltage gain and offset
+    float _voltage_offset;             // (offset applies to single-phase only)
+    CalibrationSolver _calibration;    // Guided calibration session
+    uint8_t _cal_phase;                // Channel being calibrated
+    RangeDiagnostics _range;           // Clipping of the last window
+    float _reconstructed_current;      // Window current with clipped peaks restored
+    float _over_range_power_w;         // Power missing from the clipped window
+    EnergyAccumulator _over_range;     // Energy estimated beyond the ADC range
+    uint32_t _saturated_windows;       // Windows flagged saturated
+    NoiseFloor _noise[MAX_GAIN_RANGES]; // Learned idle current channel noise per range
+    LearnedState _saved_state;         // Last state written to NVS
+    uint32_t _learned_saved_ms;        // millis() of that write
+    bool _have_saved_state;            // NVS holds a state for this configuration
+    bool _warm;                        // Smoothing seeded by a valid window since begin()
+    ThreePhaseMeter _three_phase;      // Per-phase DSP for three-phase mode
+    SequenceComponents _voltage_sequence; // Voltage symmetrical components
+    SequenceComponents _current_sequence; // Current symmetrical components
+    uint32_t _sequence_cycles;         // CPU cycles of the last sequence computation
+    uint32_t _clock_base;              // Unix time at last sync
+    unsigned long _clock_millis;       // millis() at last sync
+    DemandMeter _demand;               // Block and rolling demand
+    RollupStore* _rollups;             // Optional multi-resolution history
+    int64_t _rollup_energy_mj;         // Energy already reported to rollups
+    DailyPercentiles* _percentiles;    // Optional quantile sketches
+    LoadEventDetector* _load_events;   // Optional appliance step detector
+    AnomalyDetector* _anomalies;       // Optional anomaly detector
+    EnergyForecaster* _forecaster;     // Optional hourly energy forecaster
+    TariffEngine* _tariff;             // Optional time-of-use registers
+    MeasurementSnapshot* _snapshot;    // Optional cross-task readings
+    uint32_t _window_count;            // Windows since begin()
+    EventBus* _bus;                    // Optional event fan-out
+    uint32_t _load_events_seen;        // Detector totals already published
+    uint32_t _anomalies_seen;
+    MonitorConfig _pending;            // Staged by reconfigure()
+    uint8_t _pending_source;
+    std::atomic<uint8_t> _pending_state; // RECONFIG_*
+    uint32_t _reconfigures;            // Applied since boot
+    StageTiming* _timing;              // Optional stage durations
+    uint32_t _stage_start_us;          // Start of the stage being timed
 
     void sampleVoltage();       // Basic voltage sampling
     void calculateCurrent();    // Main current calculation routine
+    void processCurrentWindow(); // Current, CT and range checks on a filled window
+    void setVoltage(uint32_t sum); // Single-phase voltage from VOLTAGE_SAMPLES readings
+    void calculateThreePhase(); // Interleaved per-phase acquisition
+    void calculateSequence();   // Symmetrical components from phasors
     void updateEnergy();        // Update energy accumulation
-    float calculatePowerFactor(); // Calculate power factor (for future use)
-    void resetOffsetFilters();  // Reset offset tracking after reconnect
-    bool checkCTStateChange(bool new_state); // Debounce CT state changes
-    bool validateReading(int32_t adc_value); // Validate single ADC reading
+    void applyGainRange();      // Select pin and attenuation of the active range
+    void applyWiring();         // Pins, kernel and scales for the current config
+    bool takePendingConfig(uint8_t& source);
+    void applyPendingConfig();  // At a window boundary
+    void updateScales();        // Push calibrated scales to the three-phase DSP
+    static uint8_t wiredChannels(const uint8_t pins[PHASES]);
+    void feedCalibration(float voltage, float current, float power, float reactive);
+    void captureLearnedState(LearnedState& state) const;
+    void maybeSaveLearnedState();
+    float calculatePowerFactor(); // Calculate total power factor
+    void publishWindow();       // Snapshot and bus after each window
+    void markStage(uint8_t stage); // Close the timed stage, start the next
 };
 
 #endif
@@ -0,0 +1,100 @@
+#include "quantile_sketch.h"
+#include <math.h>
+#include <string.h>
+
+static const float GAMMA = (1.0f + SKETCH_RELATIVE_ERROR) / (1.0f - SKETCH_RELATIVE_ERROR);
+static const float INV_LOG_GAMMA = 1.0f / logf(GAMMA);
+
+QuantileSketch::QuantileSketch(float min_value)
+    : _min_value(min_value) {
+    clear();
+}
+
+void QuantileSketch::clear() {
+    memset(_counts, 0, sizeof(_counts));
+    _below = 0;
+    _count = 0;
+    _min = 0;
+    _max = 0;
+}
+
+void QuantileSketch::add(float value) {
+    if (_count == 0 || value < _min) _min = value;
+    if (_count == 0 || value > _max) _max = value;
+    _count++;
+
+    if (value <= _min_value) {
+        _below++;
+        return;
+    }
+
+    int32_t k = (int32_t)ceilf(logf(value / _min_value) * INV_LOG_GAMMA);
+    if (k < 0) k = 0;
+    if (k >= SKETCH_BUCKETS) k = SKETCH_BUCKETS - 1;  // Clamped; max still exact
+    _counts[k]++;
+}
+
+bool QuantileSketch::merge(const QuantileSketch& other) {
+    if (other._min_value != _min_value) return false;
+    if (other._count == 0) return true;
+
+    for (uint16_t k = 0; k < SKETCH_BUCKETS; k++) {
+        _counts[k] += other._counts[k];
+    }
+    _below += other._below;
+    if (_count == 0 || other._min < _min) _min = other._min;
+    if (_count == 0 || other._max > _max) _max = other._max;
+    _count += other._count;
+    return true;
+}
+
+float QuantileSketch::quantile(float q) const {
+    if (_count == 0) return 0;
+    if (q <= 0) return _min;
+    if (q >= 1) return _max;
+
+    uint32_t rank = (uint32_t)(q * (_count - 1));
+    uint32_t seen = _below;
+    float value = _min;
+
+    if (seen <= rank) {
+        for (uint16_t k = 0; k < SKETCH_BUCKETS; k++) {
+            seen += _counts[k];
+            if (seen > rank) {
+                // Midpoint in relative terms: within e of every value in the bucket
+                value = _min_value * powf(GAMMA, k) * 2.0f / (GAMMA + 1.0f);
+                break;
+            }
+        }
+    }
+
+    if (value < _min) value = _min;
+    if (value > _max) value = _max;
+    return value;
+}
+
+DailyPercentiles::DailyPercentiles()
+    : _today(0), _day(0) {
+    for (uint8_t i = 0; i < 2; i++) {
+        _current[i] = QuantileSketch(SKETCH_MIN_CURRENT);
+        _power[i] = QuantileSketch(SKETCH_MIN_POWER);
+    }
+}
+
+void DailyPercentiles::add(uint32_t now_s, float current, float power) {
+    uint32_t day = now_s / SECONDS_PER_DAY;
+    if (day != _day) {
+        // Yesterday only if the new day directly follows
+        _today ^= 1;
+        _current[_today].clear();
+        _power[_today].clear();
+        if (day != _day + 1) {
+            _current[_today ^ 1].clear();
+            _power[_today ^ 1].clear();
+        }
+        _day = day;
+    }
+
+    _current[_today].add(current);
+    _power[_today].add(power);
+}
@@ -0,0 +1,57 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <stdint.h>
+
+// Sketch Configuration
+#define SKETCH_BUCKETS 320          // Log buckets per sketch (4 bytes each)
+#define SKETCH_RELATIVE_ERROR 0.02  // Relative accuracy of every quantile
+#define SKETCH_MIN_CURRENT 0.01     // Smallest current resolved, A (range x3.6e5)
+#define SKETCH_MIN_POWER 1.0        // Smallest power resolved, W
+#define SECONDS_PER_DAY 86400
+
+// Fixed-memory log-bucket quantile sketch. Bucket k holds values in
+// (min*g^(k-1), min*g^k] with g = (1+e)/(1-e), so any quantile inside the
+// covered range is returned within relative error e. Two sketches with the
+// same minimum merge by adding counts.
+class QuantileSketch {
+public:
+    QuantileSketch(float min_value = SKETCH_MIN_CURRENT);
+    void add(float value);
+    bool merge(const QuantileSketch& other);   // False if bucket layouts differ
+    void clear();
+    float quantile(float q) const;             // q in [0, 1]; 0 if empty
+
+    uint32_t getCount() const { return _count; }
+    float getMin() const { return _min; }
+    float getMax() const { return _max; }
+    static uint32_t getMemoryBytes() { return sizeof(QuantileSketch); }
+
+private:
+    float _min_value;           // Lower edge of bucket 0
+    uint32_t _below;            // Values at or below _min_value (idle)
+    uint32_t _counts[SKETCH_BUCKETS];
+    uint32_t _count;
+    float _min;
+    float _max;
+};
+
+// Today's and yesterday's current and power distributions
+class DailyPercentiles {
+public:
+    DailyPercentiles();
+    void add(uint32_t now_s, float current, float power);
+
+    const QuantileSketch& getCurrentToday() const { return _current[_today]; }
+    const QuantileSketch& getPowerToday() const { return _power[_today]; }
+    const QuantileSketch& getCurrentYesterday() const { return _current[_today ^ 1]; }
+    const QuantileSketch& getPowerYesterday() const { return _power[_today ^ 1]; }
+
+private:
+    QuantileSketch _current[2];
+    QuantileSketch _power[2];
+    uint8_t _today;             // Index of today's sketches
+    uint32_t _day;              // Day number of today's sketches
+};
+
+#endif
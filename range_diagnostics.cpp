@@ -0,0 +1,47 @@
+#include "range_diagnostics.h"
+#include <math.h>
+
+// Amplitude of a sine spending `fraction` of its cycle beyond `level`
+static float clippedAmplitude(float level, float fraction) {
+    if (fraction > CLIP_MAX_FRACTION) fraction = CLIP_MAX_FRACTION;
+    return level / cosf((float)M_PI * fraction);
+}
+
+void analyzeRange(const CtDetector& window, float measured_rms, RangeDiagnostics& out) {
+    float bias = window.getBias();
+    float high_level = (4095 - CT_RAIL_MARGIN) - bias;
+    float low_level = bias - CT_RAIL_MARGIN;
+
+    out.clipped_low = window.getLowRailSamples();
+    out.clipped_high = window.getHighRailSamples();
+    out.samples = window.getSamples();
+    out.min_raw = window.getMinRaw();
+    out.max_raw = window.getMaxRaw();
+    out.measured_rms = measured_rms;
+    out.reconstructed_rms = measured_rms;
+
+    float headroom_high = high_level > 0 ? (4095 - out.max_raw) / (4095 - bias) : 0;
+    float headroom_low = low_level > 0 ? out.min_raw / bias : 0;
+    out.headroom_pct = 100.0f * (headroom_high < headroom_low ? headroom_high : headroom_low);
+    if (out.headroom_pct < 0) out.headroom_pct = 0;
+
+    float n = out.samples;
+    out.saturated = n > 0 && (out.clipped_low + out.clipped_high) > CLIP_SATURATION_FRACTION * n;
+    if (!out.saturated) return;
+
+    // Average the amplitude implied by each clipped side
+    float amplitude = 0;
+    uint8_t sides = 0;
+    if (out.clipped_high > 0 && high_level > 0) {
+        amplitude += clippedAmplitude(high_level, out.clipped_high / n);
+        sides++;
+    }
+    if (out.clipped_low > 0 && low_level > 0) {
+        amplitude += clippedAmplitude(low_level, out.clipped_low / n);
+        sides++;
+    }
+    if (sides == 0) return;
+
+    float rms = amplitude / sides / sqrtf(2.0f);
+    if (rms > out.reconstructed_rms) out.reconstructed_rms = rms;
+}
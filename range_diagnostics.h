@@ -0,0 +1,30 @@
+#ifndef RANGE_DIAGNOSTICS_H
+#define RANGE_DIAGNOSTICS_H
+
+#include <stdint.h>
+#include "ct_detector.h"
+
+// Clipping Detection
+#define CLIP_SATURATION_FRACTION 0.002 // Clipped share of a window that flags saturation
+#define CLIP_MAX_FRACTION 0.40  // Clipped share per side beyond which the estimate is capped
+
+// ADC range use of one current window
+struct RangeDiagnostics {
+    uint32_t clipped_low;       // Samples at the low rail
+    uint32_t clipped_high;      // Samples at the high rail
+    uint32_t samples;
+    int32_t min_raw;
+    int32_t max_raw;
+    float headroom_pct;         // Span left to the nearest rail, % of bias-to-rail
+    bool saturated;             // Clipped beyond CLIP_SATURATION_FRACTION
+    float measured_rms;         // Counts, as measured
+    float reconstructed_rms;    // Counts, sine amplitude fitted to the clipped share
+};
+
+// A sine of amplitude A clipped at level c spends a share f = acos(c/A)/pi
+// of each cycle beyond c, so A = c / cos(pi f) for each clipped side.
+// Distorted (core-saturated) waveforms are reconstructed as their
+// fundamental, so the estimate is a lower bound in that case.
+void analyzeRange(const CtDetector& window, float measured_rms, RangeDiagnostics& out);
+
+#endif
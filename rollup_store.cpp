@@ -0,0 +1,129 @@
+#include "rollup_store.h"
+#include <string.h>
+
+static const uint32_t LEVEL_PERIOD[ROLLUP_LEVELS] = {1, 60, 900, 3600, 86400};
+static const uint16_t LEVEL_SLOTS[ROLLUP_LEVELS] = {
+    ROLLUP_SECOND_SLOTS, ROLLUP_MINUTE_SLOTS, ROLLUP_QUARTER_SLOTS,
+    ROLLUP_HOUR_SLOTS, ROLLUP_DAY_SLOTS
+};
+static const uint16_t LEVEL_OFFSET[ROLLUP_LEVELS] = {
+    0,
+    ROLLUP_SECOND_SLOTS,
+    ROLLUP_SECOND_SLOTS + ROLLUP_MINUTE_SLOTS,
+    ROLLUP_SECOND_SLOTS + ROLLUP_MINUTE_SLOTS + ROLLUP_QUARTER_SLOTS,
+    ROLLUP_SECOND_SLOTS + ROLLUP_MINUTE_SLOTS + ROLLUP_QUARTER_SLOTS + ROLLUP_HOUR_SLOTS
+};
+
+RollupStore::RollupStore() {
+    clear();
+}
+
+void RollupStore::clear() {
+    memset(_slots, 0, sizeof(_slots));
+    memset(_open, 0, sizeof(_open));
+    memset(_head, 0, sizeof(_head));
+    memset(_count, 0, sizeof(_count));
+}
+
+uint32_t RollupStore::getPeriod(uint8_t level) {
+    return level < ROLLUP_LEVELS ? LEVEL_PERIOD[level] : 0;
+}
+
+void RollupStore::startBucket(RollupBucket& bucket, uint32_t start) {
+    memset(&bucket, 0, sizeof(bucket));
+    bucket.start = start;
+}
+
+void RollupStore::merge(RollupBucket& into, const RollupBucket& from) {
+    if (from.windows == 0) return;
+
+    RollupStat* dst[3] = {&into.voltage, &into.current, &into.power};
+    const RollupStat* src[3] = {&from.voltage, &from.current, &from.power};
+    for (uint8_t i = 0; i < 3; i++) {
+        if (into.windows == 0 || src[i]->min < dst[i]->min) dst[i]->min = src[i]->min;
+        if (into.windows == 0 || src[i]->max > dst[i]->max) dst[i]->max = src[i]->max;
+        dst[i]->avg += src[i]->avg * from.windows;  // Sum until finish()
+        dst[i]->last = src[i]->last;
+    }
+    into.energy_wh += from.energy_wh;
+    into.windows += from.windows;
+}
+
+void RollupStore::finish(RollupBucket& bucket) {
+    if (bucket.windows == 0) return;
+    bucket.voltage.avg /= bucket.windows;
+    bucket.current.avg /= bucket.windows;
+    bucket.power.avg /= bucket.windows;
+}
+
+void RollupStore::close(uint8_t level) {
+    RollupBucket& open = _open[level];
+    finish(open);
+
+    _slots[LEVEL_OFFSET[level] + _head[level]] = open;
+    _head[level] = (_head[level] + 1) % LEVEL_SLOTS[level];
+    if (_count[level] < LEVEL_SLOTS[level]) _count[level]++;
+
+    if (level + 1 < ROLLUP_LEVELS) {
+        merge(_open[level + 1], open);
+    }
+}
+
+uint8_t RollupStore::add(uint32_t now_s, float voltage, float current, float power, float energy_wh) {
+    uint8_t closed = 0;
+
+    // Bottom-up so each closing bucket lands in its parent before the parent closes.
+    // Periods nest, so once a level stays open every level above it does too.
+    for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+        uint32_t start = now_s - now_s % LEVEL_PERIOD[level];
+        if (_open[level].start == start) break;
+
+        if (_open[level].windows > 0) {
+            close(level);
+            closed |= 1 << level;
+        }
+        startBucket(_open[level], start);
+    }
+
+    // A one-window bucket has itself as avg; merge() weights it by one
+    RollupBucket sample;
+    startBucket(sample, now_s);
+    sample.windows = 1;
+    sample.voltage.min = sample.voltage.max = sample.voltage.avg = sample.voltage.last = voltage;
+    sample.current.min = sample.current.max = sample.current.avg = sample.current.last = current;
+    sample.power.min = sample.power.max = sample.power.avg = sample.power.last = power;
+    sample.energy_wh = energy_wh;
+    merge(_open[ROLLUP_SECOND], sample);
+
+    return closed;
+}
+
+uint16_t RollupStore::getCount(uint8_t level) const {
+    return level < ROLLUP_LEVELS ? _count[level] : 0;
+}
+
+bool RollupStore::getBucket(uint8_t level, uint16_t age, RollupBucket& out) const {
+    if (level >= ROLLUP_LEVELS || age >= _count[level]) return false;
+
+    uint16_t slots = LEVEL_SLOTS[level];
+    uint16_t index = (_head[level] + slots - 1 - age) % slots;
+    out = _slots[LEVEL_OFFSET[level] + index];
+    return true;
+}
+
+bool RollupStore::getOpenBucket(uint8_t level, RollupBucket& out) const {
+    if (level >= ROLLUP_LEVELS || _open[level].windows == 0) return false;
+
+    out = _open[level];
+    finish(out);
+    return true;
+}
+
+float RollupStore::getOpenEnergyWh(uint8_t level) const {
+    // Open buckets hold only closed children, so add the open ones below
+    float energy_wh = 0;
+    for (uint8_t l = 0; l <= level && l < ROLLUP_LEVELS; l++) {
+        energy_wh += _open[l].energy_wh;
+    }
+    return energy_wh;
+}
@@ -0,0 +1,67 @@
+#ifndef ROLLUP_STORE_H
+#define ROLLUP_STORE_H
+
+#include <stdint.h>
+
+// Rollup Levels
+#define ROLLUP_SECOND  0
+#define ROLLUP_MINUTE  1
+#define ROLLUP_QUARTER 2
+#define ROLLUP_HOUR    3
+#define ROLLUP_DAY     4
+#define ROLLUP_LEVELS  5
+
+// History kept per level (closed buckets)
+#define ROLLUP_SECOND_SLOTS  60  // 1 minute of seconds
+#define ROLLUP_MINUTE_SLOTS  60  // 1 hour of minutes
+#define ROLLUP_QUARTER_SLOTS 96  // 1 day of 15 minute buckets
+#define ROLLUP_HOUR_SLOTS    48  // 2 days of hours
+#define ROLLUP_DAY_SLOTS     31  // 1 month of days
+#define ROLLUP_TOTAL_SLOTS (ROLLUP_SECOND_SLOTS + ROLLUP_MINUTE_SLOTS + \
+                            ROLLUP_QUARTER_SLOTS + ROLLUP_HOUR_SLOTS + ROLLUP_DAY_SLOTS)
+
+struct RollupStat {
+    float min;
+    float max;
+    float avg;                  // Running sum while the bucket is open
+    float last;
+};
+
+struct RollupBucket {
+    uint32_t start;             // Bucket start, seconds since epoch
+    uint32_t windows;           // Measurement windows merged
+    RollupStat voltage;
+    RollupStat current;
+    RollupStat power;
+    float energy_wh;            // Energy delta over the bucket
+};
+
+// Cascading fixed-size ring buffers of min/max/avg/last at 1 s, 1 min,
+// 15 min, 1 h and 1 day. Each measurement window goes into the open
+// 1 s bucket; a bucket is merged into the next level when its period
+// ends, so an insert touches at most one bucket per level.
+class RollupStore {
+public:
+    RollupStore();
+    uint8_t add(uint32_t now_s, float voltage, float current, float power, float energy_wh); // Returns mask of levels closed
+    void clear();
+
+    uint16_t getCount(uint8_t level) const;     // Closed buckets held
+    bool getBucket(uint8_t level, uint16_t age, RollupBucket& out) const; // age 0 = newest closed
+    bool getOpenBucket(uint8_t level, RollupBucket& out) const;           // In-progress bucket
+    float getOpenEnergyWh(uint8_t level) const; // Energy so far in the current period, all levels below included
+    static uint32_t getPeriod(uint8_t level);   // Bucket length in seconds
+
+private:
+    RollupBucket _slots[ROLLUP_TOTAL_SLOTS];    // All rings, level after level
+    RollupBucket _open[ROLLUP_LEVELS];          // Buckets being filled
+    uint16_t _head[ROLLUP_LEVELS];              // Next slot to write per level
+    uint16_t _count[ROLLUP_LEVELS];             // Closed buckets per level
+
+    void close(uint8_t level);
+    static void merge(RollupBucket& into, const RollupBucket& from);
+    static void startBucket(RollupBucket& bucket, uint32_t start);
+    static void finish(RollupBucket& bucket);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SAMPLE_KERNEL_H
+#define SAMPLE_KERNEL_H
+
+#include <stdint.h>
+#include "ct_detector.h"
+#include "three_phase.h"
+
+// Front-end constants of a meter. A traits struct gives them at compile
+// time, with the same member names:
+//
+//   struct MyMeter {
+//       static constexpr uint16_t samples = 1480;        // Single-phase window
+//       static constexpr uint16_t frames = 1200;         // Three-phase window
+//       static constexpr uint8_t voltage_channels = 1;   // 1: B/C derived from A
+//       static constexpr uint8_t current_channels = 3;   // 1: CT on phase A only
+//       static constexpr float amps_per_count = 0.0776f;
+//       static constexpr float smoothing = 0.95f;
+//   };
+//
+// The loops below specialise on the window length and the wired channels.
+// amps_per_count and smoothing are applied once per window, not per
+// sample, so they only seed MeterConfig. MeterConfig carries the scalars
+// at run time for boards configured in the field; wired channels then
+// come from the pins.
+struct MeterConfig {
+    uint16_t samples;
+    uint16_t frames;
+    float amps_per_count;       // Coarse-range ADC counts to amps
+    float smoothing;            // Single-phase current EWMA weight of the old value
+
+    template <class Traits>
+    static MeterConfig of() {
+        MeterConfig c = {Traits::samples, Traits::frames, Traits::amps_per_count, Traits::smoothing};
+        return c;
+    }
+};
+
+// One single-phase window. With the count fixed by Traits the loop bound is
+// a constant and the compiler unrolls it; read() returns one raw sample.
+template <class Traits, class Read>
+inline void sampleWindow(CtDetector& window, Read read) {
+    for (uint16_t i = 0; i < Traits::samples; i++) {
+        window.addSample(read());
+    }
+}
+
+template <class Read>
+inline void sampleWindow(CtDetector& window, Read read, uint16_t samples) {
+    for (uint16_t i = 0; i < samples; i++) {
+        window.addSample(read());
+    }
+}
+
+// One three-phase window, interleaved Va, Ia, Vb, Ib, Vc, Ic per frame.
+// Traits fixes which channels are wired, so the per-channel pin checks of
+// the runtime variant drop out, and addFrame() is compiled for the same
+// wiring: derived or wired B/C voltage and only the wired CTs summed.
+// read(pin) returns one raw sample.
+template <class Traits, class Read>
+inline void sampleFrames(ThreePhaseMeter& meter, const uint8_t voltage_pins[PHASES],
+                         const uint8_t current_pins[PHASES], Read read) {
+    int16_t voltage[PHASES] = {0, 0, 0};
+    int16_t current[PHASES] = {ADC_MIDPOINT, ADC_MIDPOINT, ADC_MIDPOINT};
+    for (uint16_t n = 0; n < Traits::frames; n++) {
+        for (uint8_t p = 0; p < PHASES; p++) {
+            if (p < Traits::voltage_channels) voltage[p] = read(voltage_pins[p]);
+            if (p < Traits::current_channels) current[p] = read(current_pins[p]);
+        }
+        meter.addFrame<(Traits::voltage_channels < PHASES), Traits::current_channels>(voltage, current);
+    }
+}
+
+template <class Read>
+inline void sampleFrames(ThreePhaseMeter& meter, const uint8_t voltage_pins[PHASES],
+                         const uint8_t current_pins[PHASES], Read read, uint16_t frames) {
+    int16_t voltage[PHASES] = {0, 0, 0};
+    int16_t current[PHASES] = {ADC_MIDPOINT, ADC_MIDPOINT, ADC_MIDPOINT};
+    for (uint16_t n = 0; n < frames; n++) {
+        for (uint8_t p = 0; p < PHASES; p++) {
+            if (voltage_pins[p] != NO_PIN) voltage[p] = read(voltage_pins[p]);
+            if (current_pins[p] != NO_PIN) current[p] = read(current_pins[p]);
+        }
+        meter.addFrame(voltage, current);
+    }
+}
+
+#endif
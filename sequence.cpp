@@ -0,0 +1,43 @@
+#include "sequence.h"
+#include <math.h>
+
+// a = 1 at 120 degrees
+#define A_RE -0.5f
+#define A_IM 0.8660254f
+
+static inline Phasor rotate(const Phasor& x, float c, float s) {
+    Phasor r = { x.re * c - x.im * s, x.re * s + x.im * c };
+    return r;
+}
+
+static inline float magnitude(const Phasor& x) {
+    return sqrtf(x.re * x.re + x.im * x.im);
+}
+
+void computeSequence(const Phasor abc[PHASES], SequenceComponents& out) {
+    const Phasor& a = abc[PHASE_A];
+    Phasor b_fwd = rotate(abc[PHASE_B], A_RE, A_IM);   // a * Vb
+    Phasor b_rev = rotate(abc[PHASE_B], A_RE, -A_IM);  // a^2 * Vb
+    Phasor c_fwd = rotate(abc[PHASE_C], A_RE, A_IM);   // a * Vc
+    Phasor c_rev = rotate(abc[PHASE_C], A_RE, -A_IM);  // a^2 * Vc
+
+    const float third = 1.0f / 3.0f;
+    out.zero.re = (a.re + abc[PHASE_B].re + abc[PHASE_C].re) * third;
+    out.zero.im = (a.im + abc[PHASE_B].im + abc[PHASE_C].im) * third;
+    out.positive.re = (a.re + b_fwd.re + c_rev.re) * third;
+    out.positive.im = (a.im + b_fwd.im + c_rev.im) * third;
+    out.negative.re = (a.re + b_rev.re + c_fwd.re) * third;
+    out.negative.im = (a.im + b_rev.im + c_fwd.im) * third;
+
+    out.zero_mag = magnitude(out.zero);
+    out.positive_mag = magnitude(out.positive);
+    out.negative_mag = magnitude(out.negative);
+
+    if (out.positive_mag > 0) {
+        out.negative_ratio = out.negative_mag / out.positive_mag * 100.0f;
+        out.zero_ratio = out.zero_mag / out.positive_mag * 100.0f;
+    } else {
+        out.negative_ratio = 0;
+        out.zero_ratio = 0;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include "three_phase.h"
+
+// Sequence Thresholds
+#define VOLTAGE_UNBALANCE_LIMIT 2.0  // Negative/positive voltage ratio limit, % (EN 50160)
+#define SINGLE_PHASING_RATIO 50.0    // Negative/positive current ratio for a lost phase, %
+#define MIN_SEQUENCE_CURRENT 0.5     // Positive sequence current needed to judge, A
+
+// Symmetrical components of one set of phase phasors
+struct SequenceComponents {
+    Phasor zero;
+    Phasor positive;
+    Phasor negative;
+    float zero_mag;             // |X0|
+    float positive_mag;         // |X1|
+    float negative_mag;         // |X2|
+    float negative_ratio;       // |X2| / |X1| in percent
+    float zero_ratio;           // |X0| / |X1| in percent
+};
+
+// Fortescue transform of phasors A, B, C into zero, positive and negative sequence
+void computeSequence(const Phasor abc[PHASES], SequenceComponents& out);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define RING_ALIGN 64           // Producer and consumer indices on separate cache lines
+
+// Wait-free ring of N fixed-size slots between one producer and one
+// consumer task. Slots are borrowed in place on both sides, so a frame is
+// written and read without copying. Indices run freely and wrap at 2^32;
+// N must be a power of two. A full ring refuses the write and counts an
+// overrun instead of overwriting a slot the consumer may be reading.
+template <class T, uint16_t N>
+class SpscRing {
+public:
+    SpscRing() : _head(0), _overruns(0), _tail(0) {
+        static_assert(N > 0 && (N & (N - 1)) == 0, "ring size must be a power of two");
+    }
+
+    // Producer: borrow the next free slot, or NULL when full
+    T* beginWrite() {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N) {
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        return &_slots[head & (N - 1)];
+    }
+
+    // Producer: hand the slot from beginWrite() to the consumer
+    void endWrite() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: borrow the oldest written slot, or NULL when empty
+    const T* beginRead() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail) {
+            return 0;
+        }
+        return &_slots[tail & (N - 1)];
+    }
+
+    // Consumer: return the slot from beginRead() to the producer
+    void endRead() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t getWritten() const { return _head.load(std::memory_order_relaxed); }
+    uint32_t getRead() const { return _tail.load(std::memory_order_relaxed); }
+    uint32_t getOverruns() const { return _overruns.load(std::memory_order_relaxed); }
+    uint16_t getCapacity() const { return N; }
+
+private:
+    alignas(RING_ALIGN) std::atomic<uint32_t> _head;    // Slots written, producer-owned
+    std::atomic<uint32_t> _overruns;                    // Writes refused while full
+    alignas(RING_ALIGN) std::atomic<uint32_t> _tail;    // Slots read, consumer-owned
+    alignas(RING_ALIGN) T _slots[N];
+};
+
+#endif
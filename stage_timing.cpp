@@ -0,0 +1,24 @@
+#include "stage_timing.h"
+
+StageTiming::StageTiming() {
+    for (uint8_t s = 0; s < STAGES; s++) {
+        _count[s] = 0;
+        _last_us[s] = 0;
+        _max_us[s] = 0;
+        _mean_us[s] = 0;
+    }
+}
+
+void StageTiming::record(uint8_t stage, uint32_t duration_us) {
+    if (stage >= STAGES) return;
+    uint32_t count = _count[stage] + 1;
+    _last_us[stage] = duration_us;
+    if (duration_us > _max_us[stage]) _max_us[stage] = duration_us;
+    _mean_us[stage] = _mean_us[stage] + ((float)duration_us - _mean_us[stage]) / count;
+    _count[stage] = count;
+}
+
+const char* StageTiming::getName(uint8_t stage) {
+    static const char* const names[STAGES] = {"acquire", "dsp", "energy", "log", "display"};
+    return stage < STAGES ? names[stage] : "?";
+}
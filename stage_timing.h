@@ -0,0 +1,35 @@
+#ifndef STAGE_TIMING_H
+#define STAGE_TIMING_H
+
+#include <stdint.h>
+
+// Pipeline stages
+#define STAGE_ACQUIRE 0         // Sampling a window or frame
+#define STAGE_DSP     1         // Window processing up to the energy update
+#define STAGE_ENERGY  2         // Energy, demand, history and detectors
+#define STAGE_LOG     3         // SD log entry
+#define STAGE_DISPLAY 4         // LCD redraw
+#define STAGES        5
+
+// Duration of each pipeline stage since boot: count, last, mean and max.
+// Each stage is recorded by one task; record() is a handful of stores, so
+// it stays on in production. Other tasks read the 32-bit figures directly.
+class StageTiming {
+public:
+    StageTiming();
+    void record(uint8_t stage, uint32_t duration_us);
+
+    uint32_t getCount(uint8_t stage) const { return stage < STAGES ? _count[stage] : 0; }
+    uint32_t getLastUs(uint8_t stage) const { return stage < STAGES ? _last_us[stage] : 0; }
+    uint32_t getMaxUs(uint8_t stage) const { return stage < STAGES ? _max_us[stage] : 0; }
+    float getMeanUs(uint8_t stage) const { return stage < STAGES ? _mean_us[stage] : 0; }
+    static const char* getName(uint8_t stage);
+
+private:
+    volatile uint32_t _count[STAGES];
+    volatile uint32_t _last_us[STAGES];
+    volatile uint32_t _max_us[STAGES];
+    volatile float _mean_us[STAGES];
+};
+
+#endif
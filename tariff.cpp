@@ -0,0 +1,195 @@
+#include "tariff.h"
+#include <string.h>
+
+#define SECONDS_PER_DAY_T 86400
+#define SLOT_SECONDS (TARIFF_SLOT_MINUTES * 60)
+
+TariffEngine::TariffEngine()
+    : _band_count(0), _holiday_count(0),
+      _utc_offset_s(0), _dst_rule(DST_NONE),
+      _offset_now(0), _offset_from(0), _offset_until(0),
+      _cached_day(0), _row(NULL), _current_band(0) {
+    memset(_bands, 0, sizeof(_bands));
+    memset(_table, 0, sizeof(_table));
+    memset(_season_of_month, 0, sizeof(_season_of_month));
+    memset(_holidays, 0, sizeof(_holidays));
+    invalidate();
+}
+
+void TariffEngine::invalidate() {
+    _row = NULL;
+    _offset_from = 1;
+    _offset_until = 0;          // Empty range forces updateOffset()
+}
+
+int8_t TariffEngine::addBand(const char* name, float price_per_kwh) {
+    if (_band_count >= MAX_TARIFF_BANDS) return -1;
+    TariffBand& band = _bands[_band_count];
+    strncpy(band.name, name, TARIFF_NAME_LEN - 1);
+    band.name[TARIFF_NAME_LEN - 1] = '\0';
+    band.price_per_kwh = price_per_kwh;
+    return _band_count++;
+}
+
+void TariffEngine::setSeason(uint8_t season, uint8_t first_month, uint8_t last_month) {
+    if (season >= MAX_TARIFF_SEASONS || first_month < 1 || first_month > 12 ||
+        last_month < 1 || last_month > 12) return;
+    for (uint8_t m = first_month; ; m = m % 12 + 1) {
+        _season_of_month[m - 1] = season;
+        if (m == last_month) break;
+    }
+    invalidate();
+}
+
+void TariffEngine::setBand(uint8_t season, uint8_t day_type, uint16_t start_hhmm, uint16_t end_hhmm, uint8_t band) {
+    if (season >= MAX_TARIFF_SEASONS || day_type >= DAY_TYPES || band >= MAX_TARIFF_BANDS) return;
+
+    uint16_t start = ((start_hhmm / 100) * 60 + start_hhmm % 100) / TARIFF_SLOT_MINUTES;
+    uint16_t end = ((end_hhmm / 100) * 60 + end_hhmm % 100) / TARIFF_SLOT_MINUTES;
+    start %= TARIFF_SLOTS_PER_DAY;
+    end %= TARIFF_SLOTS_PER_DAY;
+
+    // end <= start wraps past midnight; equal means the whole day
+    uint16_t slot = start;
+    do {
+        _table[season][day_type][slot] = band;
+        slot = (slot + 1) % TARIFF_SLOTS_PER_DAY;
+    } while (slot != end);
+    invalidate();
+}
+
+bool TariffEngine::addHoliday(uint16_t year, uint8_t month, uint8_t day) {
+    if (_holiday_count >= MAX_HOLIDAYS || month < 1 || month > 12 || day < 1 || day > 31) return false;
+    _holidays[_holiday_count++] = year == 0 ? -(int32_t)(month * 100 + day) : daysFromCivil(year, month, day);
+    invalidate();
+    return true;
+}
+
+void TariffEngine::setTimezone(int32_t utc_offset_s, uint8_t dst_rule) {
+    _utc_offset_s = utc_offset_s;
+    _dst_rule = dst_rule;
+    invalidate();
+}
+
+void TariffEngine::updateOffset(uint32_t unix_time) {
+    _offset_now = _utc_offset_s;
+    if (_dst_rule == DST_NONE) {
+        _offset_from = 0;
+        _offset_until = UINT32_MAX;
+        return;
+    }
+
+    int32_t year;
+    uint8_t month, day;
+    civilFromDays(unix_time / SECONDS_PER_DAY_T, year, month, day);
+    uint32_t year_start = (uint32_t)daysFromCivil(year, 1, 1) * SECONDS_PER_DAY_T;
+    uint32_t year_end = (uint32_t)daysFromCivil(year + 1, 1, 1) * SECONDS_PER_DAY_T;
+
+    uint32_t start, end;
+    if (_dst_rule == DST_EU) {
+        start = (uint32_t)nthSunday(year, 3, -1) * SECONDS_PER_DAY_T + 3600;
+        end = (uint32_t)nthSunday(year, 10, -1) * SECONDS_PER_DAY_T + 3600;
+    } else {
+        start = (uint32_t)nthSunday(year, 3, 2) * SECONDS_PER_DAY_T + 7200 - _utc_offset_s;
+        end = (uint32_t)nthSunday(year, 11, 1) * SECONDS_PER_DAY_T + 7200 - (_utc_offset_s + 3600);
+    }
+
+    if (unix_time < start) {
+        _offset_from = year_start;
+        _offset_until = start;
+    } else if (unix_time < end) {
+        _offset_now += 3600;
+        _offset_from = start;
+        _offset_until = end;
+    } else {
+        _offset_from = end;
+        _offset_until = year_end;
+    }
+}
+
+uint32_t TariffEngine::toLocal(uint32_t unix_time) {
+    if (unix_time < _offset_from || unix_time >= _offset_until) {
+        updateOffset(unix_time);
+    }
+    return unix_time + _offset_now;
+}
+
+void TariffEngine::selectRow(int32_t day) {
+    int32_t year;
+    uint8_t month, mday;
+    civilFromDays(day, year, month, mday);
+
+    uint8_t day_type = DAY_WEEKDAY;
+    uint8_t wd = weekday(day);
+    if (wd == 0 || wd == 6) day_type = DAY_WEEKEND;
+    int32_t annual = -(int32_t)(month * 100 + mday);
+    for (uint8_t i = 0; i < _holiday_count; i++) {
+        if (_holidays[i] == day || _holidays[i] == annual) day_type = DAY_HOLIDAY;
+    }
+
+    _row = _table[_season_of_month[month - 1]][day_type];
+    _cached_day = day;
+}
+
+uint8_t TariffEngine::lookup(uint32_t unix_time) {
+    uint32_t local = toLocal(unix_time);
+    int32_t day = local / SECONDS_PER_DAY_T;
+    if (_row == NULL || day != _cached_day) {
+        selectRow(day);
+    }
+    _current_band = _row[(local % SECONDS_PER_DAY_T) / SLOT_SECONDS];
+    return _current_band;
+}
+
+void TariffEngine::addEnergy(uint32_t unix_time, float power_w, uint32_t elapsed_ms) {
+    _registers[lookup(unix_time)].add(power_w, elapsed_ms);
+}
+
+void TariffEngine::resetRegisters() {
+    for (uint8_t b = 0; b < MAX_TARIFF_BANDS; b++) {
+        _registers[b].reset();
+    }
+}
+
+double TariffEngine::getTotalCost() const {
+    double cost = 0;
+    for (uint8_t b = 0; b < _band_count; b++) {
+        cost += getBandCost(b);
+    }
+    return cost;
+}
+
+// Howard Hinnant's days_from_civil / civil_from_days
+int32_t TariffEngine::daysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yoe = (uint32_t)(year - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+void TariffEngine::civilFromDays(int32_t days, int32_t& year, uint8_t& month, uint8_t& day) {
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = (uint32_t)(days - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = (int32_t)yoe + era * 400 + (month <= 2);
+}
+
+uint8_t TariffEngine::weekday(int32_t days) {
+    return (uint8_t)(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+}
+
+int32_t TariffEngine::nthSunday(int32_t year, uint8_t month, int8_t n) {
+    if (n < 0) {
+        int32_t last = (month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, month + 1, 1)) - 1;
+        return last - weekday(last);
+    }
+    int32_t first = daysFromCivil(year, month, 1);
+    return first + (7 - weekday(first)) % 7 + 7 * (n - 1);
+}
@@ -0,0 +1,88 @@
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include <stdint.h>
+#include "energy_accumulator.h"
+
+// Schedule Dimensions
+#define MAX_TARIFF_BANDS 4
+#define MAX_TARIFF_SEASONS 2
+#define MAX_HOLIDAYS 16
+#define TARIFF_SLOT_MINUTES 30
+#define TARIFF_SLOTS_PER_DAY (24 * 60 / TARIFF_SLOT_MINUTES)
+#define TARIFF_NAME_LEN 8
+
+// Day Types
+#define DAY_WEEKDAY 0
+#define DAY_WEEKEND 1
+#define DAY_HOLIDAY 2
+#define DAY_TYPES   3
+
+// Daylight Saving Rules
+#define DST_NONE 0
+#define DST_EU   1              // Last Sunday of March to last Sunday of October, 01:00 UTC
+#define DST_US   2              // Second Sunday of March to first Sunday of November, 02:00 local
+
+struct TariffBand {
+    char name[TARIFF_NAME_LEN];
+    float price_per_kwh;
+};
+
+// Time-of-use schedule compiled into a [season][day type][slot] band
+// table. The season and day type are resolved once per local day, so each
+// energy update is a clock offset and one indexed lookup.
+class TariffEngine {
+public:
+    TariffEngine();
+
+    // Schedule definition
+    int8_t addBand(const char* name, float price_per_kwh);   // Index or -1 if full
+    void setSeason(uint8_t season, uint8_t first_month, uint8_t last_month); // Months 1-12, may wrap
+    void setBand(uint8_t season, uint8_t day_type, uint16_t start_hhmm, uint16_t end_hhmm, uint8_t band);
+    bool addHoliday(uint16_t year, uint8_t month, uint8_t day);  // Year 0 repeats every year
+    void setTimezone(int32_t utc_offset_s, uint8_t dst_rule);
+
+    // Metering
+    uint8_t lookup(uint32_t unix_time);                       // Band at this instant
+    void addEnergy(uint32_t unix_time, float power_w, uint32_t elapsed_ms);
+    void resetRegisters();
+
+    uint8_t getBandCount() const { return _band_count; }
+    const TariffBand& getBand(uint8_t band) const { return _bands[band]; }
+    double getBandKWh(uint8_t band) const { return _registers[band].getKWh(); }
+    double getBandCost(uint8_t band) const { return _registers[band].getKWh() * _bands[band].price_per_kwh; }
+    double getTotalCost() const;
+    uint8_t getCurrentBand() const { return _current_band; }
+    uint32_t toLocal(uint32_t unix_time);                     // Local seconds since epoch
+
+    // Civil calendar helpers (proleptic Gregorian, days since 1970-01-01)
+    static int32_t daysFromCivil(int32_t year, uint8_t month, uint8_t day);
+    static void civilFromDays(int32_t days, int32_t& year, uint8_t& month, uint8_t& day);
+    static uint8_t weekday(int32_t days);                     // 0 = Sunday
+
+private:
+    TariffBand _bands[MAX_TARIFF_BANDS];
+    uint8_t _band_count;
+    uint8_t _table[MAX_TARIFF_SEASONS][DAY_TYPES][TARIFF_SLOTS_PER_DAY];
+    uint8_t _season_of_month[12];
+    int32_t _holidays[MAX_HOLIDAYS];          // Local day numbers, or -(month * 100 + day) every year
+    uint8_t _holiday_count;
+    EnergyAccumulator _registers[MAX_TARIFF_BANDS];
+
+    int32_t _utc_offset_s;      // Standard time offset
+    uint8_t _dst_rule;
+    int32_t _offset_now;        // Offset valid in [_offset_from, _offset_until)
+    uint32_t _offset_from;
+    uint32_t _offset_until;
+
+    int32_t _cached_day;        // Local day of _row
+    const uint8_t* _row;        // Band per slot for the cached day
+    uint8_t _current_band;
+
+    void updateOffset(uint32_t unix_time);
+    void selectRow(int32_t day);
+    static int32_t nthSunday(int32_t year, uint8_t month, int8_t n); // n < 0 counts from month end
+    void invalidate();
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "task_stats.h"
+
+TaskStats::TaskStats(uint32_t period_us, bool fixed_rate)
+    : _period_us(period_us), _fixed_rate(fixed_rate), _started(false),
+      _reset_requested(false), _interval_start_us(0), _last_begin_us(0),
+      _last_end_us(0), _busy_us(0), _max_busy_us(0), _worst_latency_us(0),
+      _last_latency_us(0), _iterations(0), _max_latency_us(0), _max_gap_us(0) {
+    for (uint8_t b = 0; b < LATENESS_BUCKETS; b++) {
+        _lateness[b] = 0;
+    }
+}
+
+uint32_t TaskStats::getLatenessLimitUs(uint8_t bucket) {
+    static const uint32_t limits[LATENESS_BUCKETS] = {100, 500, 1000, 2000, 5000, 10000, 50000, UINT32_MAX};
+    return bucket < LATENESS_BUCKETS ? limits[bucket] : UINT32_MAX;
+}
+
+void TaskStats::begin(uint32_t now_us) {
+    if (_reset_requested || !_started) {
+        _reset_requested = false;
+        _interval_start_us = now_us;
+        _busy_us = 0;
+        _max_busy_us = 0;
+        _worst_latency_us = 0;
+        _iterations = 0;
+    }
+
+    if (_started) {
+        uint32_t gap = now_us - _last_begin_us;
+        if (gap > _max_gap_us) _max_gap_us = gap;
+    }
+    if (_started && _period_us) {
+        uint32_t due = (_fixed_rate ? _last_begin_us : _last_end_us) + _period_us;
+        int32_t late = (int32_t)(now_us - due);     // Wrap-safe across micros() rollover
+        _last_latency_us = late > 0 ? late : 0;
+        if (_last_latency_us > _worst_latency_us) _worst_latency_us = _last_latency_us;
+        if (_last_latency_us > _max_latency_us) _max_latency_us = _last_latency_us;
+        uint8_t bucket = 0;
+        while (_last_latency_us >= getLatenessLimitUs(bucket)) bucket++;
+        _lateness[bucket]++;
+    }
+    _started = true;
+    _last_begin_us = now_us;
+}
+
+void TaskStats::end(uint32_t now_us) {
+    uint32_t busy = now_us - _last_begin_us;
+    _busy_us += busy;
+    if (busy > _max_busy_us) _max_busy_us = busy;
+    _last_end_us = now_us;
+    _iterations++;
+}
+
+float TaskStats::getLoadPct() const {
+    uint32_t elapsed = _last_end_us - _interval_start_us;
+    return elapsed > 0 ? 100.0f * _busy_us / elapsed : 0;
+}
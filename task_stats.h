@@ -0,0 +1,55 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stdint.h>
+
+#define LATENESS_BUCKETS 8      // Wake-up lateness histogram, see getLatenessLimitUs()
+
+// CPU share and scheduling latency of one periodic task, recorded by the
+// task itself around each iteration. Latency is how far a wake-up fell
+// behind the time it was due: a fixed-rate task is due one period after
+// the previous wake, a delay-based task one period after the previous
+// iteration ended. An event-driven task passes a period of 0 and records
+// load only. Other tasks may read the figures and ask for a new interval;
+// the owner applies the reset on its next begin(). The lateness histogram,
+// max latency and longest gap between wake-ups run since boot; the gap is
+// the task watchdog's feed interval when the task feeds it on each wake.
+class TaskStats {
+public:
+    TaskStats(uint32_t period_us, bool fixed_rate);
+    void begin(uint32_t now_us);    // Task woke
+    void end(uint32_t now_us);      // Iteration done, about to block
+    void requestReset() { _reset_requested = true; }
+
+    float getLoadPct() const;       // Busy share of the interval so far
+    uint32_t getWorstLatencyUs() const { return _worst_latency_us; }
+    uint32_t getLastLatencyUs() const { return _last_latency_us; }
+    uint32_t getMaxBusyUs() const { return _max_busy_us; }
+    uint32_t getIterations() const { return _iterations; }
+    bool isPeriodic() const { return _period_us != 0; }
+
+    // Since boot
+    uint32_t getLatenessCount(uint8_t bucket) const { return bucket < LATENESS_BUCKETS ? _lateness[bucket] : 0; }
+    static uint32_t getLatenessLimitUs(uint8_t bucket); // Bucket holds latencies below this
+    uint32_t getMaxLatencyUs() const { return _max_latency_us; }
+    uint32_t getMaxGapUs() const { return _max_gap_us; }
+
+private:
+    uint32_t _period_us;
+    bool _fixed_rate;           // Due from the last wake rather than the last end
+    bool _started;
+    volatile bool _reset_requested;
+    uint32_t _interval_start_us; // Start of the reporting interval
+    uint32_t _last_begin_us;
+    uint32_t _last_end_us;
+    uint64_t _busy_us;          // Busy time in this interval
+    uint32_t _max_busy_us;
+    uint32_t _worst_latency_us;
+    uint32_t _last_latency_us;
+    uint32_t _iterations;
+    uint32_t _lateness[LATENESS_BUCKETS];
+    uint32_t _max_latency_us;
+    uint32_t _max_gap_us;       // Longest begin() to begin()
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "three_phase.h"
+#include <math.h>
+#include <string.h>
+
+ThreePhaseMeter::ThreePhaseMeter()
+    : _derived(false), _voltage_scale(0), _current_scale(0),
+      _frame(0), _delay_b(0), _delay_c(0), _period_frames(0),
+      _last_va(0), _osc_cos(1), _osc_sin(0), _step_cos(1), _step_sin(0),
+      _armed(false), _crossings(0),
+      _first_crossing(0), _last_crossing(0),
+      _have_start(false), _have_end(false),
+      _total_power_w(0), _neutral_a(0),
+      _voltage_unbalance(0), _current_unbalance(0),
+      _frequency_hz(0), _frame_rate_hz(0), _cycles(0) {
+    for (uint8_t p = 0; p < PHASES; p++) {
+        _voltage_center[p] = ADC_MIDPOINT;
+        _current_center[p] = ADC_MIDPOINT;
+    }
+    memset(_history, 0, sizeof(_history));
+    memset(_phase, 0, sizeof(_phase));
+    memset(_voltage_phasor, 0, sizeof(_voltage_phasor));
+    memset(_current_phasor, 0, sizeof(_current_phasor));
+    memset(&_sums, 0, sizeof(_sums));
+}
+
+void ThreePhaseMeter::setDerivedVoltage(bool derived) {
+    _derived = derived;
+}
+
+void ThreePhaseMeter::setScales(float voltage_scale, float current_scale) {
+    _voltage_scale = voltage_scale;
+    _current_scale = current_scale;
+}
+
+void ThreePhaseMeter::beginWindow() {
+    memset(&_sums, 0, sizeof(_sums));
+    _frame = 0;
+    _last_va = 0;
+    _osc_cos = 1;
+    _osc_sin = 0;
+    _armed = false;
+    _crossings = 0;
+    _have_start = false;
+    _have_end = false;
+    _cycles = 0;
+}
+
+void ThreePhaseMeter::addFrame(const int16_t voltage[PHASES], const int16_t current[PHASES]) {
+    if (_derived) {
+        addFrame<true, PHASES>(voltage, current);
+    } else {
+        addFrame<false, PHASES>(voltage, current);
+    }
+}
+
+void ThreePhaseMeter::endWindow(uint32_t window_us, const CalibrationTable* current_cal) {
+    if (window_us > 0) {
+        _frame_rate_hz = _frame * 1000000.0f / window_us;
+    }
+
+    if (_crossings >= 2) {
+        _period_frames = (_last_crossing - _first_crossing) / (_crossings - 1);
+        _frequency_hz = _frame_rate_hz / _period_frames;
+    } else {
+        _frequency_hz = 0;
+        if (_period_frames == 0 && _frame_rate_hz > 0) {
+            _period_frames = _frame_rate_hz / NOMINAL_FREQUENCY;
+        }
+    }
+    updateDelays();
+
+    // Track channel offsets from the whole window mean
+    if (_sums.frames > 0) {
+        for (uint8_t p = 0; p < PHASES; p++) {
+            _current_center[p] += lroundf((float)_sums.i[p] / _sums.frames);
+            if (p == PHASE_A || !_derived) {
+                _voltage_center[p] += lroundf((float)_sums.v[p] / _sums.frames);
+            }
+        }
+    }
+
+    Sums s = _sums;
+    if (_have_end) {
+        s.frames = _end.frames - _start.frames;
+        for (uint8_t p = 0; p < PHASES; p++) {
+            s.v[p] = _end.v[p] - _start.v[p];
+            s.i[p] = _end.i[p] - _start.i[p];
+            s.vv[p] = _end.vv[p] - _start.vv[p];
+            s.ii[p] = _end.ii[p] - _start.ii[p];
+            s.vi[p] = _end.vi[p] - _start.vi[p];
+            s.v_re[p] = _end.v_re[p] - _start.v_re[p];
+            s.v_im[p] = _end.v_im[p] - _start.v_im[p];
+            s.i_re[p] = _end.i_re[p] - _start.i_re[p];
+            s.i_im[p] = _end.i_im[p] - _start.i_im[p];
+        }
+        s.n = _end.n - _start.n;
+        s.nn = _end.nn - _start.nn;
+    }
+
+    if (s.frames == 0) {
+        memset(_phase, 0, sizeof(_phase));
+        memset(_voltage_phasor, 0, sizeof(_voltage_phasor));
+        memset(_current_phasor, 0, sizeof(_current_phasor));
+        _total_power_w = 0;
+        _neutral_a = 0;
+        _voltage_unbalance = 0;
+        _current_unbalance = 0;
+        return;
+    }
+
+    float n = s.frames;
+    float voltages[PHASES], currents[PHASES];
+    _total_power_w = 0;
+
+    for (uint8_t p = 0; p < PHASES; p++) {
+        float mean_v = s.v[p] / n;
+        float mean_i = s.i[p] / n;
+        float var_v = s.vv[p] / n - mean_v * mean_v;
+        float var_i = s.ii[p] / n - mean_i * mean_i;
+        float cov = s.vi[p] / n - mean_v * mean_i;
+
+        PhaseReading& r = _phase[p];
+        r.voltage_v = sqrtf(var_v > 0 ? var_v : 0) * _voltage_scale;
+        r.current_a = sqrtf(var_i > 0 ? var_i : 0) * _current_scale;
+        r.power_w = cov * _voltage_scale * _current_scale;
+
+        // Single-bin DFT over whole cycles rejects DC; sqrt(2)/N gives RMS
+        float phasor_scale = sqrtf(2.0f) / n;
+        Phasor& vp = _voltage_phasor[p];
+        Phasor& ip = _current_phasor[p];
+        vp.re = s.v_re[p] * phasor_scale * _voltage_scale;
+        vp.im = s.v_im[p] * phasor_scale * _voltage_scale;
+        ip.re = s.i_re[p] * phasor_scale * _current_scale;
+        ip.im = s.i_im[p] * phasor_scale * _current_scale;
+
+        // Once-per-window CT correction: scale by gain and rotate the current
+        // back by the phase lead, which turns S = P + jQ by the same angle
+        if (current_cal) {
+            float gain, phase;
+            current_cal[p].lookup(r.current_a, gain, phase);
+            float c = cosf(phase), sn = sinf(phase);
+            float q = vp.im * ip.re - vp.re * ip.im;
+            r.power_w = gain * (r.power_w * c - q * sn);
+            r.current_a *= gain;
+            float re = ip.re;
+            ip.re = gain * (re * c + ip.im * sn);
+            ip.im = gain * (ip.im * c - re * sn);
+        }
+
+        float apparent = r.voltage_v * r.current_a;
+        r.power_factor = apparent > 0 ? r.power_w / apparent : 0;
+
+        _total_power_w += r.power_w;
+        voltages[p] = r.voltage_v;
+        currents[p] = r.current_a;
+    }
+
+    float mean_n = s.n / n;
+    float var_n = s.nn / n - mean_n * mean_n;
+    _neutral_a = sqrtf(var_n > 0 ? var_n : 0) * _current_scale;
+
+    _voltage_unbalance = unbalancePct(voltages);
+    _current_unbalance = unbalancePct(currents);
+}
+
+void ThreePhaseMeter::updateDelays() {
+    _delay_b = lroundf(_period_frames / 3.0f);
+    _delay_c = lroundf(_period_frames * 2.0f / 3.0f);
+
+    float step = _period_frames > 0 ? 2.0f * (float)M_PI / _period_frames : 0;
+    _step_cos = cosf(step);
+    _step_sin = sinf(step);
+
+    // History too short for this frame rate: derived phases stay invalid
+    if (_delay_c >= VOLTAGE_HISTORY) {
+        _delay_b = 0;
+        _delay_c = 0;
+    }
+}
+
+// NEMA definition: maximum deviation from the average, in percent of the average
+float ThreePhaseMeter::unbalancePct(const float values[PHASES]) {
+    float avg = (values[PHASE_A] + values[PHASE_B] + values[PHASE_C]) / PHASES;
+    if (avg <= 0) return 0;
+
+    float max_dev = 0;
+    for (uint8_t p = 0; p < PHASES; p++) {
+        float dev = fabsf(values[p] - avg);
+        if (dev > max_dev) max_dev = dev;
+    }
+    return max_dev / avg * 100.0f;
+}
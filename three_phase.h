@@ -0,0 +1,191 @@
+#ifndef THREE_PHASE_H
+#define THREE_PHASE_H
+
+#include <stdint.h>
+#include "calibration_table.h"
+
+// Phase indices
+#define PHASE_A 0
+#define PHASE_B 1
+#define PHASE_C 2
+#define PHASES  3
+#define NO_PIN  0xFF            // Channel not wired
+
+// Interleaved Acquisition
+#define THREE_PHASE_FRAMES 1200 // Frames (one reading of every channel) per window
+#define VOLTAGE_HISTORY 1024    // Phase A history for derived B/C voltages (power of 2)
+#define NOMINAL_FREQUENCY 50.0  // Mains frequency assumed until zero crossings are seen
+#define ZERO_CROSS_HYSTERESIS 20 // ADC counts phase A must dip below zero to re-arm
+#define ADC_MIDPOINT 1880       // Initial channel offset before the first window
+
+// Fundamental phasor, RMS magnitude
+struct Phasor {
+    float re;
+    float im;
+};
+
+// Per-phase result of one measurement window
+struct PhaseReading {
+    float voltage_v;            // RMS voltage
+    float current_a;            // RMS current
+    float power_w;              // Real power (mean of v*i)
+    float power_factor;         // P / (Vrms * Irms), signed
+};
+
+// Accumulates one interleaved window of V/I frames and reduces it to
+// per-phase readings. Integration runs between the first and last rising
+// zero crossing of phase A so that only whole cycles are summed.
+class ThreePhaseMeter {
+public:
+    ThreePhaseMeter();
+    void setDerivedVoltage(bool derived);    // B/C voltages shifted from phase A
+    void setScales(float voltage_scale, float current_scale); // ADC counts to V / A
+    void beginWindow();
+    void addFrame(const int16_t voltage[PHASES], const int16_t current[PHASES]);
+    template <bool Derived, uint8_t CurrentChannels>   // Wiring fixed at compile time, must match setDerivedVoltage()
+    void addFrame(const int16_t voltage[PHASES], const int16_t current[PHASES]);
+    void endWindow(uint32_t window_us, const CalibrationTable* current_cal = 0); // Tables per phase, optional
+
+    const PhaseReading& getPhase(uint8_t phase) const { return _phase[phase < PHASES ? phase : PHASE_A]; }
+    float getTotalPowerW() const { return _total_power_w; }
+    float getNeutralCurrentA() const { return _neutral_a; }
+    float getVoltageUnbalancePct() const { return _voltage_unbalance; } // 0 with derived B/C
+    float getCurrentUnbalancePct() const { return _current_unbalance; }
+    float getFrequencyHz() const { return _frequency_hz; }
+    float getFrameRateHz() const { return _frame_rate_hz; }
+    uint16_t getCyclesIntegrated() const { return _cycles; }
+    bool isVoltageDerived() const { return _derived; }
+    const Phasor& getVoltagePhasor(uint8_t phase) const { return _voltage_phasor[phase < PHASES ? phase : PHASE_A]; }
+    const Phasor& getCurrentPhasor(uint8_t phase) const { return _current_phasor[phase < PHASES ? phase : PHASE_A]; }
+
+private:
+    struct Sums {
+        int64_t v[PHASES];      // Sum of centered voltage
+        int64_t i[PHASES];      // Sum of centered current
+        int64_t vv[PHASES];     // Sum of voltage squared
+        int64_t ii[PHASES];     // Sum of current squared
+        int64_t vi[PHASES];     // Sum of instantaneous power
+        int64_t n;              // Sum of neutral (ia + ib + ic)
+        int64_t nn;             // Sum of neutral squared
+        float v_re[PHASES];     // Voltage correlated with the fundamental
+        float v_im[PHASES];
+        float i_re[PHASES];     // Current correlated with the fundamental
+        float i_im[PHASES];
+        uint32_t frames;        // Frames accumulated
+    };
+
+    bool _derived;              // Phase B/C voltage derived from phase A
+    float _voltage_scale;       // Counts to volts
+    float _current_scale;       // Counts to amps
+    int32_t _voltage_center[PHASES]; // Offset subtracted before summing
+    int32_t _current_center[PHASES];
+    int16_t _history[VOLTAGE_HISTORY]; // Centered phase A voltage
+    uint32_t _frame;            // Frame index within window
+    uint32_t _delay_b;          // Phase B lag in frames (T/3)
+    uint32_t _delay_c;          // Phase C lag in frames (2T/3)
+    float _period_frames;       // Measured mains period in frames, 0 if unknown
+    int32_t _last_va;           // Previous centered phase A sample
+    float _osc_cos;             // Fundamental reference oscillator
+    float _osc_sin;
+    float _step_cos;            // Per-frame rotation of the oscillator
+    float _step_sin;
+    bool _armed;                // Phase A went negative since last crossing
+    uint16_t _crossings;        // Rising zero crossings this window
+    float _first_crossing;      // Interpolated frame of first crossing
+    float _last_crossing;       // Interpolated frame of last crossing
+    Sums _sums;                 // Running sums for the window
+    Sums _start;                // Sums at first whole-cycle boundary
+    Sums _end;                  // Sums at last whole-cycle boundary
+    bool _have_start;           // _start holds a snapshot
+    bool _have_end;             // _end holds a snapshot
+
+    PhaseReading _phase[PHASES];
+    Phasor _voltage_phasor[PHASES];
+    Phasor _current_phasor[PHASES];
+    float _total_power_w;
+    float _neutral_a;
+    float _voltage_unbalance;
+    float _current_unbalance;
+    float _frequency_hz;
+    float _frame_rate_hz;
+    uint16_t _cycles;           // Whole cycles integrated, 0 if whole window
+
+    void updateDelays();
+    static float unbalancePct(const float values[PHASES]);
+};
+
+// One frame with the wiring as constants: the derived/wired voltage branch
+// and the sums of unwired current channels drop out of the loop. Unwired
+// channels read as their center, so the readings match the runtime path.
+template <bool Derived, uint8_t CurrentChannels>
+void ThreePhaseMeter::addFrame(const int16_t voltage[PHASES], const int16_t current[PHASES]) {
+    int32_t va = voltage[PHASE_A] - _voltage_center[PHASE_A];
+    _history[_frame & (VOLTAGE_HISTORY - 1)] = (int16_t)va;
+
+    // Derived B/C need 2T/3 of phase A history before they are valid
+    bool accumulate = !Derived || (_delay_c > 0 && _frame >= _delay_c);
+
+    if (accumulate) {
+        int32_t v[PHASES];
+        v[PHASE_A] = va;
+        if (Derived) {
+            v[PHASE_B] = _history[(_frame - _delay_b) & (VOLTAGE_HISTORY - 1)];
+            v[PHASE_C] = _history[(_frame - _delay_c) & (VOLTAGE_HISTORY - 1)];
+        } else {
+            v[PHASE_B] = voltage[PHASE_B] - _voltage_center[PHASE_B];
+            v[PHASE_C] = voltage[PHASE_C] - _voltage_center[PHASE_C];
+        }
+
+        int32_t neutral = 0;
+        for (uint8_t p = 0; p < PHASES; p++) {
+            _sums.v[p] += v[p];
+            _sums.vv[p] += v[p] * v[p];
+            _sums.v_re[p] += v[p] * _osc_cos;
+            _sums.v_im[p] -= v[p] * _osc_sin;
+            if (p < CurrentChannels) {
+                int32_t i = current[p] - _current_center[p];
+                _sums.i[p] += i;
+                _sums.ii[p] += i * i;
+                _sums.vi[p] += v[p] * i;
+                _sums.i_re[p] += i * _osc_cos;
+                _sums.i_im[p] -= i * _osc_sin;
+                neutral += i;
+            }
+        }
+        _sums.n += neutral;
+        _sums.nn += neutral * neutral;
+        _sums.frames++;
+    }
+
+    // Rising zero crossing of phase A marks a whole-cycle boundary
+    if (va < -ZERO_CROSS_HYSTERESIS) {
+        _armed = true;
+    } else if (_armed && va >= 0) {
+        _armed = false;
+        float position = (_frame - 1) + (float)(-_last_va) / (float)(va - _last_va);
+        if (_crossings == 0) _first_crossing = position;
+        _last_crossing = position;
+        _crossings++;
+
+        if (accumulate) {
+            if (!_have_start) {
+                _start = _sums;
+                _have_start = true;
+            } else {
+                _end = _sums;
+                _have_end = true;
+                _cycles++;
+            }
+        }
+    }
+
+    // Advance the reference by one frame of the fundamental
+    float c = _osc_cos * _step_cos - _osc_sin * _step_sin;
+    _osc_sin = _osc_sin * _step_cos + _osc_cos * _step_sin;
+    _osc_cos = c;
+
+    _last_va = va;
+    _frame++;
+}
+
+#endif
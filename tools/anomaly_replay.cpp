@@ -0,0 +1,241 @@
+// Host replay of synthetic days through AnomalyDetector. Each trace in
+// tools/traces describes a household's loads and voltage events, plus the
+// anomalies the detector must report. The runner expands a trace into
+// 100 ms windows with deterministic noise and feeds every window to the
+// detector. An expected event that is never logged is a miss, and a logged
+// event that no expectation covers is a false alarm. Either one fails the
+// trace.
+//
+//   g++ -O2 -I.. anomaly_replay.cpp ../anomaly_detector.cpp -o anomaly_replay
+//   ./anomaly_replay traces/*.trace
+//
+// Trace lines, times as hh:mm or hh:mm:ss and days as N, N-M or *:
+//   days N                                  length of the replay
+//   voltage V                               nominal voltage (230)
+//   noise PCT                               window power noise, % (2)
+//   load DAYS FROM TO WATTS                 constant load in the interval
+//   cycle DAYS FROM TO WATTS ON_MIN OFF_MIN duty-cycled load, phase from trace start
+//   sag DAY AT SECONDS VOLTS                voltage held at VOLTS
+//   expect KIND DAY FROM TO                 KIND is voltage, current, power or baseload
+// '#' starts a comment.
+
+#include "anomaly_detector.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_EPOCH 1767225600u // 2026-01-01 00:00 UTC, a day boundary
+#define WINDOWS_PER_SECOND 10
+#define SECONDS_PER_DAY 86400
+#define MAX_ITEMS 32
+#define MAX_EXPECT 16
+
+static const char* KIND_NAMES[ANOMALY_KINDS] = {"voltage", "current", "power", "baseload"};
+
+struct Item {
+    enum { LOAD, CYCLE, SAG } type;
+    int first_day, last_day;    // 1-based, inclusive
+    uint32_t from_s, to_s;      // Seconds into the day
+    float value;                // Watts, or volts for a sag
+    uint32_t on_s, period_s;    // Duty cycle
+};
+
+struct Expect {
+    uint8_t kind;
+    int day;
+    uint32_t from_s, to_s;
+    bool hit;
+};
+
+struct Trace {
+    int days;
+    float voltage;
+    float noise;
+    Item items[MAX_ITEMS];
+    uint8_t item_count;
+    Expect expects[MAX_EXPECT];
+    uint8_t expect_count;
+};
+
+static bool parseTime(const char* text, uint32_t& seconds) {
+    int h, m, s = 0;
+    if (sscanf(text, "%d:%d:%d", &h, &m, &s) < 2 || h > 24 || m > 59 || s > 59) return false;
+    seconds = h * 3600 + m * 60 + s;
+    return seconds <= SECONDS_PER_DAY;
+}
+
+static bool parseDays(const char* text, int days, int& first, int& last) {
+    if (strcmp(text, "*") == 0) {
+        first = 1;
+        last = days;
+    } else if (sscanf(text, "%d-%d", &first, &last) == 2) {
+    } else if (sscanf(text, "%d", &first) == 1) {
+        last = first;
+    } else {
+        return false;
+    }
+    return first >= 1 && first <= last;
+}
+
+static int kindOf(const char* name) {
+    for (int k = 0; k < ANOMALY_KINDS; k++) {
+        if (strcmp(name, KIND_NAMES[k]) == 0) return k;
+    }
+    return -1;
+}
+
+static bool loadTrace(const char* path, Trace& trace) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    memset(&trace, 0, sizeof(trace));
+    trace.days = 1;
+    trace.voltage = 230;
+    trace.noise = 2;
+
+    char line[160];
+    int number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        number++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        char word[16], a[16], b[16], c[16], d[16];
+        float value = 0, on_min = 0, off_min = 0;
+        int fields = sscanf(line, "%15s %15s %15s %15s %15s", word, a, b, c, d);
+        if (fields <= 0) continue;
+
+        if (strcmp(word, "days") == 0 && fields == 2) {
+            trace.days = atoi(a);
+        } else if (strcmp(word, "voltage") == 0 && fields == 2) {
+            trace.voltage = atof(a);
+        } else if (strcmp(word, "noise") == 0 && fields == 2) {
+            trace.noise = atof(a);
+        } else if ((strcmp(word, "load") == 0 || strcmp(word, "cycle") == 0) && trace.item_count < MAX_ITEMS) {
+            Item& item = trace.items[trace.item_count];
+            bool cycle = word[0] == 'c';
+            int got = sscanf(line, "%*s %*s %*s %*s %f %f %f", &value, &on_min, &off_min);
+            ok = got == (cycle ? 3 : 1) && parseDays(a, trace.days, item.first_day, item.last_day) &&
+                 parseTime(b, item.from_s) && parseTime(c, item.to_s);
+            item.type = cycle ? Item::CYCLE : Item::LOAD;
+            item.value = value;
+            item.on_s = (uint32_t)(on_min * 60);
+            item.period_s = (uint32_t)((on_min + off_min) * 60);
+            trace.item_count++;
+        } else if (strcmp(word, "sag") == 0 && fields == 5 && trace.item_count < MAX_ITEMS) {
+            Item& item = trace.items[trace.item_count++];
+            uint32_t seconds = atoi(c);
+            ok = parseDays(a, trace.days, item.first_day, item.last_day) && parseTime(b, item.from_s);
+            item.type = Item::SAG;
+            item.to_s = item.from_s + seconds;
+            item.value = atof(d);
+        } else if (strcmp(word, "expect") == 0 && fields == 5 && trace.expect_count < MAX_EXPECT) {
+            Expect& expect = trace.expects[trace.expect_count++];
+            int kind = kindOf(a);
+            expect.day = atoi(b);
+            expect.kind = kind < 0 ? 0 : kind;
+            ok = kind >= 0 && expect.day >= 1 && parseTime(c, expect.from_s) && parseTime(d, expect.to_s);
+        } else {
+            ok = false;
+        }
+        if (!ok) fprintf(stderr, "%s:%d: cannot parse: %s", path, number, line);
+    }
+    fclose(file);
+    return ok;
+}
+
+static uint32_t rng = 1;
+
+static float noise() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng & 0xFFFF) / 32768.0f - 1.0f;   // -1 .. 1
+}
+
+static bool runTrace(const char* path) {
+    Trace trace;
+    if (!loadTrace(path, trace)) {
+        printf("%s: unreadable\n", path);
+        return false;
+    }
+
+    static AnomalyDetector detector;
+    detector.reset();
+    rng = 1;
+    uint32_t false_alarms = 0;
+    uint32_t seen = 0;
+
+    for (int day = 1; day <= trace.days; day++) {
+        for (uint32_t s = 0; s < SECONDS_PER_DAY; s++) {
+            uint32_t elapsed = (day - 1) * SECONDS_PER_DAY + s;
+            float power = 0;
+            float voltage = trace.voltage;
+            for (uint8_t i = 0; i < trace.item_count; i++) {
+                const Item& item = trace.items[i];
+                if (day < item.first_day || day > item.last_day || s < item.from_s || s >= item.to_s) continue;
+                if (item.type == Item::SAG) {
+                    voltage = item.value;
+                } else if (item.type == Item::LOAD || elapsed % item.period_s < item.on_s) {
+                    power += item.value;
+                }
+            }
+
+            for (int w = 0; w < WINDOWS_PER_SECOND; w++) {
+                float p = power * (1.0f + trace.noise / 100.0f * noise()) + noise();
+                float v = voltage + 0.5f * noise();
+                detector.update(TRACE_EPOCH + elapsed, v, p / v, p);
+            }
+
+            // Check each new event against the expectations
+            while (seen < detector.getTotalEvents()) {
+                AnomalyEvent event;
+                detector.getEvent(detector.getTotalEvents() - 1 - seen, event);
+                seen++;
+                uint32_t at = event.time - TRACE_EPOCH;
+                int event_day = at / SECONDS_PER_DAY + 1;
+                uint32_t event_s = at % SECONDS_PER_DAY;
+                bool expected = false;
+                for (uint8_t e = 0; e < trace.expect_count; e++) {
+                    Expect& expect = trace.expects[e];
+                    if (expect.kind == event.kind && expect.day == event_day &&
+                        event_s >= expect.from_s && event_s < expect.to_s) {
+                        expect.hit = expected = true;
+                    }
+                }
+                if (!expected) false_alarms++;
+                printf("  day %d %02u:%02u:%02u %-8s value %8.2f expected %8.2f z %6.1f%s\n",
+                       event_day, event_s / 3600, event_s / 60 % 60, event_s % 60,
+                       KIND_NAMES[event.kind], event.value, event.expected, event.z,
+                       expected ? "" : "  FALSE ALARM");
+            }
+        }
+    }
+
+    uint32_t misses = 0;
+    for (uint8_t e = 0; e < trace.expect_count; e++) {
+        const Expect& expect = trace.expects[e];
+        if (expect.hit) continue;
+        misses++;
+        printf("  MISSED %s on day %d %02u:%02u-%02u:%02u\n", KIND_NAMES[expect.kind], expect.day,
+               expect.from_s / 3600, expect.from_s / 60 % 60, expect.to_s / 3600, expect.to_s / 60 % 60);
+    }
+    bool pass = misses == 0 && false_alarms == 0;
+    printf("%s: %d days, %u events, %u/%u expected, %u false alarms: %s\n", path, trace.days,
+           detector.getTotalEvents(), trace.expect_count - misses, trace.expect_count, false_alarms,
+           pass ? "ok" : "FAIL");
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace...\n", argv[0]);
+        return 2;
+    }
+    bool ok = true;
+    for (int f = 1; f < argc; f++) {
+        ok = runTrace(argv[f]) && ok;
+    }
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// Host check of CalibrationSolver against a simulated meter with known
+// voltage gain and offset, current gain error that varies with load, CT
+// phase lead and per-window noise.
+//
+//   g++ -O2 -I.. calibration_solver_sim.cpp ../calibration_solver.cpp ../calibration_table.cpp -o calibration_solver_sim
+//   ./calibration_solver_sim
+//
+// Steps through a no-load and three resistive reference loads at four mains
+// voltages, reports the windows and time each step needed, and exits
+// non-zero if the solved corrections miss the simulated errors.
+
+#include "calibration_solver.h"
+#include "calibration_table.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WINDOW_MS 100           // Loop period in the sketch
+#define TRUE_VOLTAGE_GAIN 1.02
+#define TRUE_VOLTAGE_OFFSET -3.0
+#define TRUE_PHASE_LEAD 1.5     // Degrees
+#define CURRENT_NOISE 0.003     // Relative, per window
+#define VOLTAGE_NOISE 0.2       // Volts, per window
+
+static double gaussian() {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// CT reads low at light load
+static double trueGain(double amps) {
+    return 1.0 + 0.04 / sqrt(amps > 0.1 ? amps : 0.1);
+}
+
+int main() {
+    // Reference load steps, mains moved on a variac so the offset is observable
+    static const double loads[] = {0, 1, 5, 20};
+    static const double mains_steps[] = {200, 220, 235, 250};
+    int failures = 0;
+    srand(1);
+
+    CalibrationSolver solver;
+    uint32_t now = 0;
+    for (unsigned s = 0; s < sizeof(loads) / sizeof(loads[0]); s++) {
+        double amps = loads[s];
+        double mains = mains_steps[s];
+        solver.beginStep(mains, amps, mains * amps, now);
+        bool done = false;
+        while (!done) {
+            now += WINDOW_MS;
+            double v = mains + VOLTAGE_NOISE * gaussian();
+            double measured_v = (v - TRUE_VOLTAGE_OFFSET) / TRUE_VOLTAGE_GAIN;
+            double measured_i = amps / trueGain(amps) * (1 + CURRENT_NOISE * gaussian());
+            double angle = -TRUE_PHASE_LEAD * M_PI / 180.0;
+            double s_va = measured_v * measured_i;
+            done = solver.addWindow(measured_v, measured_i, s_va * cos(angle), s_va * sin(angle), now);
+        }
+        const CalibrationStep& step = solver.getStep(s);
+        printf("step %u: %5.1f A, %3u windows, %6.1f s, %s\n", s, amps, step.windows,
+               step.duration_ms / 1000.0, step.converged ? "converged" : "stopped");
+    }
+
+    CalibrationResult result;
+    if (!solver.solve(result)) {
+        printf("solve failed\n");
+        return 1;
+    }
+
+    printf("voltage gain %.4f (true %.4f), offset %.2f (true %.2f), residual %.3f%%\n",
+           result.voltage_gain, TRUE_VOLTAGE_GAIN, result.voltage_offset, TRUE_VOLTAGE_OFFSET,
+           result.max_voltage_error_pct);
+    if (fabs(result.voltage_gain - TRUE_VOLTAGE_GAIN) > 0.005) failures++;
+    if (fabs(result.voltage_offset - TRUE_VOLTAGE_OFFSET) > 1.0) failures++;
+
+    CalibrationTable table;
+    for (uint8_t k = 0; k < result.points; k++) {
+        double truth = trueGain(result.current[k] * result.gain[k]);
+        printf("point %.3f A: gain %.4f (true %.4f), phase %.3f deg (true %.3f)\n",
+               result.current[k], result.gain[k], truth, result.phase_deg[k], TRUE_PHASE_LEAD);
+        if (fabs(result.gain[k] - truth) / truth > 0.002) failures++;
+        if (fabs(result.phase_deg[k] - TRUE_PHASE_LEAD) > 0.1) failures++;
+        table.addPoint(result.current[k], result.gain[k], result.phase_deg[k]);
+    }
+    printf("current error bound %.3f%%, residual offset %.4f A\n",
+           result.max_current_error_pct, result.current_offset_a);
+
+    // Between breakpoints the table interpolates the true curve
+    double worst = 0;
+    for (double amps = 1; amps <= 20; amps *= 1.1) {
+        float gain, phase;
+        table.lookup(amps / trueGain(amps), gain, phase);
+        double error = fabs(amps / trueGain(amps) * gain - amps) / amps * 100.0;
+        if (error > worst) worst = error;
+    }
+    printf("interpolated error 1-20 A: %.3f%%\n", worst);
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return failures ? 1 : 0;
+}
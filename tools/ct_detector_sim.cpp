@@ -0,0 +1,124 @@
+// Host simulation of CtDetector on synthetic disconnect and reconnect traces.
+//
+//   g++ -O2 -I.. ct_detector_sim.cpp ../ct_detector.cpp ../noise_floor.cpp -o ct_detector_sim
+//   ./ct_detector_sim [clean_windows]
+//
+// Clean windows draw a random load from 0 to 120 A (the top end clips both
+// rails) and report false disconnects. Each fault scenario then reports
+// how many windows pass before the disconnect is flagged, and how many
+// clean windows it takes to recover after the CT is plugged back in.
+
+#include "ct_detector.h"
+#include "noise_floor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Mirrors power_monitor.h; the window is about one mains cycle
+#define SAMPLES_PER_CYCLE 1480
+#define AMPS_PER_COUNT (0.00080566 / 10.0 * 1000 * 0.963)
+#define SAMPLE_RATE 74000.0
+#define NOISE_COUNTS 4.0
+#define BIAS 1880.0
+
+#define SCENARIO_TRIALS 200
+
+enum Fault { NONE, FLOAT_HIGH, SHORTED, OPEN_NOISE, BIAS_LOST, FAULTS };
+static const char* const names[FAULTS] = {"none", "float to rail", "shorted", "open input noise", "bias lost"};
+
+static double gaussian() {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double uniform() {
+    return rand() / (double)RAND_MAX;
+}
+
+// Feeds one window; `age` counts windows since the fault began
+static void window(CtDetector& detector, Fault fault, double amps, int age) {
+    double peak = amps / AMPS_PER_COUNT * sqrt(2.0);
+    double phase = 2.0 * M_PI * uniform();
+    detector.beginWindow();
+    for (int i = 0; i < SAMPLES_PER_CYCLE; i++) {
+        double t = i / SAMPLE_RATE;
+        double v = BIAS + peak * sin(2.0 * M_PI * 50.0 * t + phase) + NOISE_COUNTS * gaussian();
+        switch (fault) {
+            case FLOAT_HIGH:    // Input charges toward the supply through leakage
+                v = 4095 - (4095 - BIAS) * exp(-(age + i / (double)SAMPLES_PER_CYCLE) / 1.5) + NOISE_COUNTS * gaussian();
+                break;
+            case SHORTED:
+                v = 0;
+                break;
+            case OPEN_NOISE:    // High impedance: hum plus sample-and-hold kickback
+                v = BIAS + 300 * sin(2.0 * M_PI * 50.0 * t + phase) + 120 * gaussian();
+                break;
+            case BIAS_LOST:
+                v = 1200 + NOISE_COUNTS * gaussian();
+                break;
+            default:
+                break;
+        }
+        long raw = lround(v);
+        detector.addSample(raw < 0 ? 0 : (raw > 4095 ? 4095 : raw));
+    }
+}
+
+int main(int argc, char** argv) {
+    long clean_windows = argc > 1 ? atol(argv[1]) : 100000;
+    srand(1);
+
+    CtDetector detector;
+    NoiseFloor floor;
+    for (int w = 0; w < 50; w++) {
+        window(detector, NONE, 0, 0);
+        detector.endWindow(floor.getVariance());
+        floor.update(detector.getVariance(), detector.getStepNoise(), detector.getSamples());
+    }
+
+    long false_disconnects = 0;
+    for (long w = 0; w < clean_windows; w++) {
+        window(detector, NONE, uniform() < 0.3 ? 0 : 120 * uniform(), 0);
+        if (detector.endWindow(floor.getVariance()) == CT_DISCONNECTED) {
+            false_disconnects++;
+            int recover = 0;
+            do {
+                window(detector, NONE, 0, 0);
+            } while (detector.endWindow(floor.getVariance()) != CT_RECONNECTED && ++recover < 100);
+        }
+    }
+    printf("clean windows: %ld, false disconnects: %ld\n", clean_windows, false_disconnects);
+    printf("%-18s %14s %14s %10s\n", "fault", "detect max/avg", "recover max", "missed");
+
+    for (int f = FLOAT_HIGH; f < FAULTS; f++) {
+        int detect_max = 0, recover_max = 0, missed = 0;
+        long detect_sum = 0;
+        for (int trial = 0; trial < SCENARIO_TRIALS; trial++) {
+            double amps = 20 * uniform();
+            int age = 0;
+            bool detected = false;
+            for (; age < 50 && !detected; age++) {
+                window(detector, (Fault)f, amps, age);
+                detected = detector.endWindow(floor.getVariance()) == CT_DISCONNECTED;
+            }
+            if (!detected) {
+                missed++;
+                continue;
+            }
+            detect_sum += age;
+            if (age > detect_max) detect_max = age;
+
+            int recover = 0;
+            do {
+                window(detector, NONE, amps, 0);
+                recover++;
+            } while (detector.endWindow(floor.getVariance()) != CT_RECONNECTED && recover < 100);
+            if (recover > recover_max) recover_max = recover;
+        }
+        int detected = SCENARIO_TRIALS - missed;
+        printf("%-18s %8d/%-5.1f %14d %10d\n", names[f], detect_max,
+               detected ? detect_sum / (double)detected : 0.0, recover_max, missed);
+    }
+    return 0;
+}
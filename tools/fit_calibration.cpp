@@ -0,0 +1,168 @@
+// Fits per-channel CalibrationTable breakpoints from reference measurements.
+//
+//   g++ -O2 -I.. fit_calibration.cpp ../calibration_table.cpp -o fit_calibration
+//   ./fit_calibration measurements.csv [breakpoints]
+//
+// Each CSV line is `channel,reference_a,measured_a[,phase_lead_deg]` where
+// channel is 0-2 (phase A is also the single-phase CT), measured_a is the
+// uncorrected reading and phase_lead_deg how far the meter's current leads
+// the reference. Lines that do not parse (headers, comments) are skipped.
+// Breakpoints default to 0.5,1,2,5,10,20,50,100 A.
+//
+// Gain and phase are fitted as piecewise-linear functions of log current by
+// least squares, with a light second-difference penalty so breakpoints
+// without nearby data follow their neighbours. Output is one C initializer
+// per channel for PowerMonitor::setCurrentCalibration().
+
+#include "calibration_table.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANNELS 3
+#define MAX_ROWS 4096
+#define SMOOTHING 1e-3          // Second-difference penalty weight
+
+struct Row {
+    int channel;
+    double reference;
+    double measured;
+    double phase;
+};
+
+static Row rows[MAX_ROWS];
+
+// Solves a * x = b in place by Gaussian elimination with partial pivoting
+static bool solve(double a[MAX_CAL_POINTS][MAX_CAL_POINTS], double b[MAX_CAL_POINTS], int n) {
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (fabs(a[r][c]) > fabs(a[pivot][c])) pivot = r;
+        }
+        if (fabs(a[pivot][c]) < 1e-12) return false;
+        for (int k = 0; k < n; k++) {
+            double t = a[c][k]; a[c][k] = a[pivot][k]; a[pivot][k] = t;
+        }
+        double t = b[c]; b[c] = b[pivot]; b[pivot] = t;
+        for (int r = c + 1; r < n; r++) {
+            double f = a[r][c] / a[c][c];
+            for (int k = c; k < n; k++) a[r][k] -= f * a[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        for (int k = r + 1; k < n; k++) b[r] -= a[r][k] * b[k];
+        b[r] /= a[r][r];
+    }
+    return true;
+}
+
+// Hat-function weights of x over the log breakpoints, clamped at the ends
+static void basis(const double* knots, int n, double x, double* w) {
+    memset(w, 0, n * sizeof(double));
+    if (x <= knots[0]) { w[0] = 1; return; }
+    if (x >= knots[n - 1]) { w[n - 1] = 1; return; }
+    int i = 1;
+    while (knots[i] < x) i++;
+    double t = (x - knots[i - 1]) / (knots[i] - knots[i - 1]);
+    w[i - 1] = 1 - t;
+    w[i] = t;
+}
+
+static bool fit(const double* knots, int n, int channel, int count, bool phase, double* out) {
+    double a[MAX_CAL_POINTS][MAX_CAL_POINTS] = {{0}};
+    double b[MAX_CAL_POINTS] = {0};
+    double w[MAX_CAL_POINTS];
+
+    for (int r = 0; r < count; r++) {
+        if (rows[r].channel != channel) continue;
+        basis(knots, n, log(rows[r].measured), w);
+        double y = phase ? rows[r].phase : rows[r].reference / rows[r].measured;
+        for (int i = 0; i < n; i++) {
+            b[i] += w[i] * y;
+            for (int j = 0; j < n; j++) a[i][j] += w[i] * w[j];
+        }
+    }
+    for (int i = 1; i + 1 < n; i++) {
+        const int idx[3] = {i - 1, i, i + 1};
+        const double d[3] = {1, -2, 1};
+        for (int p = 0; p < 3; p++) {
+            for (int q = 0; q < 3; q++) a[idx[p]][idx[q]] += SMOOTHING * d[p] * d[q];
+        }
+    }
+    if (!solve(a, b, n)) return false;
+    memcpy(out, b, n * sizeof(double));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s measurements.csv [breakpoints]\n", argv[0]);
+        return 1;
+    }
+
+    double amps[MAX_CAL_POINTS] = {0.5, 1, 2, 5, 10, 20, 50, 100};
+    int n = MAX_CAL_POINTS;
+    if (argc > 2) {
+        n = 0;
+        for (char* tok = strtok(argv[2], ","); tok && n < MAX_CAL_POINTS; tok = strtok(NULL, ",")) {
+            amps[n++] = atof(tok);
+        }
+    }
+    double knots[MAX_CAL_POINTS];
+    for (int i = 0; i < n; i++) knots[i] = log(amps[i]);
+
+    FILE* file = fopen(argv[1], "r");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    char line[256];
+    int count = 0;
+    while (count < MAX_ROWS && fgets(line, sizeof(line), file)) {
+        Row& r = rows[count];
+        r.phase = 0;
+        int fields = sscanf(line, "%d,%lf,%lf,%lf", &r.channel, &r.reference, &r.measured, &r.phase);
+        if (fields < 3 || r.channel < 0 || r.channel >= CHANNELS || r.measured <= 0 || r.reference <= 0) continue;
+        count++;
+    }
+    fclose(file);
+
+    for (int c = 0; c < CHANNELS; c++) {
+        int samples = 0;
+        for (int r = 0; r < count; r++) samples += rows[r].channel == c;
+        if (samples == 0) continue;
+
+        double gain[MAX_CAL_POINTS], phase[MAX_CAL_POINTS];
+        if (!fit(knots, n, c, count, false, gain) || !fit(knots, n, c, count, true, phase)) {
+            fprintf(stderr, "channel %d: not enough data for %d breakpoints\n", c, n);
+            continue;
+        }
+
+        CalibrationTable table;
+        for (int i = 0; i < n; i++) table.addPoint(amps[i], gain[i], phase[i]);
+
+        double before = 0, after = 0, phase_after = 0;
+        for (int r = 0; r < count; r++) {
+            if (rows[r].channel != c) continue;
+            float g, ph;
+            table.lookup(rows[r].measured, g, ph);
+            double err0 = fabs(rows[r].measured - rows[r].reference) / rows[r].reference;
+            double err1 = fabs(rows[r].measured * g - rows[r].reference) / rows[r].reference;
+            double perr = fabs(rows[r].phase - ph * 180.0 / M_PI);
+            if (err0 > before) before = err0;
+            if (err1 > after) after = err1;
+            if (perr > phase_after) phase_after = perr;
+        }
+
+        printf("// Channel %d: %d points, max error %.2f%% -> %.2f%%, phase residual %.2f deg\n",
+               c, samples, 100 * before, 100 * after, phase_after);
+        printf("const CalibrationPoint CURRENT_CAL_%c[] = {\n", 'A' + c);
+        for (int i = 0; i < n; i++) {
+            printf("    {%g, %.5f, %.3f},\n", amps[i], gain[i], phase[i]);
+        }
+        printf("};\n");
+    }
+    return 0;
+}
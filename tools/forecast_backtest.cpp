@@ -0,0 +1,81 @@
+// Host backtest of EnergyForecaster against logged POWER_YYYYMMDD.CSV files.
+//
+//   g++ -O2 -I.. forecast_backtest.cpp ../forecaster.cpp -o forecast_backtest
+//   ./forecast_backtest /sd/POWER_20240101.CSV /sd/POWER_20240102.CSV ...
+//
+// Files must be given in date order. Hourly energy is the change of the
+// cumulative Energy(kWh) column between hours; hours spanning a reset
+// (energy going backwards) are skipped.
+
+#include "forecaster.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static bool parseDate(const char* path, struct tm& day) {
+    const char* name = strstr(path, "POWER_");
+    int y, m, d;
+    if (!name || sscanf(name, "POWER_%4d%2d%2d", &y, &m, &d) != 3) return false;
+    memset(&day, 0, sizeof(day));
+    day.tm_year = y - 1900;
+    day.tm_mon = m - 1;
+    day.tm_mday = d;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    EnergyForecaster forecaster;
+    long last_hour = -1;
+    double hour_start_kwh = -1, last_kwh = -1;
+    double abs_error = 0, sq_error = 0;
+    int scored = 0, inside_band = 0;
+
+    for (int f = 1; f < argc; f++) {
+        struct tm day;
+        FILE* file = fopen(argv[f], "r");
+        if (!file || !parseDate(argv[f], day)) {
+            fprintf(stderr, "skipping %s\n", argv[f]);
+            if (file) fclose(file);
+            continue;
+        }
+        time_t midnight = timegm(&day);
+
+        char line[160];
+        while (fgets(line, sizeof(line), file)) {
+            int hh, mm, ss;
+            float v, i, p, kwh;
+            if (sscanf(line, "%d:%d:%d,%f,%f,%f,%f", &hh, &mm, &ss, &v, &i, &p, &kwh) != 7) continue;
+
+            long hour = (long)(midnight + hh * 3600 + mm * 60 + ss) / 3600;
+            if (hour != last_hour) {
+                if (last_hour >= 0 && hour_start_kwh >= 0 && last_kwh >= hour_start_kwh) {
+                    float wh = (float)((last_kwh - hour_start_kwh) * 1000.0);
+                    if (forecaster.isReady() && hour == last_hour + 1) {
+                        float predicted = forecaster.forecastWh(1);
+                        float error = wh - predicted;
+                        abs_error += fabsf(error);
+                        sq_error += error * error;
+                        if (fabsf(error) <= forecaster.getBandWh()) inside_band++;
+                        scored++;
+                    }
+                    forecaster.addHour((uint32_t)(last_hour * 3600), wh);
+                }
+                hour_start_kwh = last_kwh >= 0 && last_kwh <= kwh ? last_kwh : kwh;
+                last_hour = hour;
+            }
+            last_kwh = kwh;
+        }
+        fclose(file);
+    }
+
+    if (scored == 0) {
+        printf("Not enough data: the model needs one full day before it forecasts\n");
+        return 1;
+    }
+    printf("Hours scored: %d\n", scored);
+    printf("MAE:  %.1f Wh\n", abs_error / scored);
+    printf("RMSE: %.1f Wh\n", sqrt(sq_error / scored));
+    printf("Band coverage: %.1f%% (target 95%%)\n", 100.0 * inside_band / scored);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Host simulation of GainRanger against a model ADC with per-range gain,
+// bias and noise.
+//
+//   g++ -O2 -I.. gain_ranging_sim.cpp ../gain_ranger.cpp ../ct_detector.cpp ../noise_floor.cpp -o gain_ranging_sim
+//   ./gain_ranging_sim [high_gain]
+//
+// Ranges are 11 dB, 6 dB and, when high_gain > 0, an amplified copy of
+// the CT signal on a second pin. A load profile steps from standby to
+// full scale and back; the table compares each step's mean error with a
+// fixed 11 dB channel and lists held (discarded) windows and switches.
+
+#include "gain_ranger.h"
+#include "noise_floor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Mirrors power_monitor.h; the window is about one mains cycle
+#define SAMPLES_PER_CYCLE 1480
+#define AMPS_PER_COUNT (0.00080566 / 10.0 * 1000 * 0.963)
+#define SAMPLE_RATE 74000.0
+#define WINDOWS_PER_STEP 40
+
+struct ModelRange {
+    double gain;                // True counts per coarse count
+    double bias;                // True bias, counts
+    double noise;               // Noise, counts RMS
+};
+
+static double gaussian() {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void window(CtDetector& detector, const ModelRange& r, double amps) {
+    double peak = amps / AMPS_PER_COUNT * sqrt(2.0) * r.gain;
+    double phase = 2.0 * M_PI * rand() / RAND_MAX;
+    detector.beginWindow();
+    for (int i = 0; i < SAMPLES_PER_CYCLE; i++) {
+        long raw = lround(r.bias + peak * sin(2.0 * M_PI * 50.0 * i / SAMPLE_RATE + phase) + r.noise * gaussian());
+        detector.addSample(raw < 0 ? 0 : (raw > 4095 ? 4095 : raw));
+    }
+}
+
+// One channel as PowerMonitor::calculateCurrent() runs it, minus smoothing
+struct Channel {
+    GainRanger ranger;
+    CtDetector detector;
+    NoiseFloor noise[MAX_GAIN_RANGES];
+    double amps;
+    int held;
+
+    Channel() : amps(0), held(0) {}
+
+    void run(const ModelRange* model, double load) {
+        uint8_t active = ranger.getCount() > 0 ? ranger.getActive() : 0;
+        window(detector, model[active], load);
+        if (!ranger.endWindow(detector)) {
+            held++;
+            return;
+        }
+        NoiseFloor& floor = noise[ranger.getActive()];
+        detector.endWindow(floor.getVariance());
+        float variance = detector.getVariance();
+        amps = floor.signalRms(variance, detector.getSamples()) * AMPS_PER_COUNT * ranger.getScale();
+        if (detector.getFaults() == 0) {
+            floor.update(variance, detector.getStepNoise(), detector.getSamples(), NoiseFloor::slewShare(50.0, SAMPLE_RATE));
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    double high_gain = argc > 1 ? atof(argv[1]) : 10.0;
+    const ModelRange model[3] = {
+        {1.0, 1880, 4.0},               // 11 dB
+        {1.5, 2820, 4.0},               // 6 dB, same bias voltage on a smaller span
+        {1.5 * high_gain, 2048, 4.0},   // Amplifier stage on a second pin at 6 dB
+    };
+    static const double profile[] = {0.05, 0.2, 1, 5, 20, 60, 100, 20, 1, 0.2, 0.05};
+
+    srand(1);
+    Channel fixed, ranged;
+    ranged.ranger.addRange(36, 3, model[0].gain, 1.0f, model[0].bias);
+    ranged.ranger.addRange(36, 2, model[1].gain, 1.0f, 2700);    // Bias guess is learned
+    if (high_gain > 0) ranged.ranger.addRange(34, 2, model[2].gain, 1.0f, 2000);
+
+    // Idle channel to learn noise floors, visiting the finer ranges too
+    for (int w = 0; w < 100; w++) {
+        fixed.run(model, 0);
+        ranged.run(model, 0);
+    }
+
+    printf("%8s %16s %16s %6s %6s %8s\n", "amps", "fixed err %", "ranged err %", "range", "held", "switches");
+    for (unsigned s = 0; s < sizeof(profile) / sizeof(profile[0]); s++) {
+        double load = profile[s];
+        double fixed_err = 0, ranged_err = 0;
+        int scored = 0;
+        ranged.held = 0;
+        for (int w = 0; w < WINDOWS_PER_STEP; w++) {
+            fixed.run(model, load);
+            ranged.run(model, load);
+            if (w >= WINDOWS_PER_STEP / 2) {    // Score after switching has settled
+                fixed_err += fabs(fixed.amps - load) / load;
+                ranged_err += fabs(ranged.amps - load) / load;
+                scored++;
+            }
+        }
+        printf("%8.2f %16.2f %16.2f %6d %6d %8u\n", load, 100 * fixed_err / scored,
+               100 * ranged_err / scored, ranged.ranger.getActive(), ranged.held,
+               (unsigned)ranged.ranger.getSwitches());
+    }
+    return 0;
+}
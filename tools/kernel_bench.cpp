@@ -0,0 +1,135 @@
+// Host benchmark of the compiled-in acquisition loops against the runtime
+// ones, with ADC reads replaced by a table lookup so only loop overhead and
+// accumulation are timed. The three-phase rows cover the wirings a traits
+// struct can fix: B/C voltage derived or wired, and one or three CTs.
+//
+//   g++ -O2 -I.. kernel_bench.cpp ../ct_detector.cpp ../three_phase.cpp ../calibration_table.cpp -o kernel_bench
+//   ./kernel_bench
+//   nm -C -S --size-sort kernel_bench | grep -E 'addFrame|sample'   # Code size per loop
+//
+// On the device analogRead() dominates a window; PowerMonitor::getWindowCycles()
+// reports the cycles of the real acquisition and isFixedKernel() which loop ran.
+// Scale and smoothing are applied once per window, so they stay runtime values.
+
+#include "sample_kernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Mirrors DefaultMeter in power_monitor.h, with the wiring as parameters
+template <uint8_t Voltages, uint8_t Currents>
+struct BenchMeter {
+    static constexpr uint16_t samples = 1480;
+    static constexpr uint16_t frames = 1200;
+    static constexpr uint8_t voltage_channels = Voltages;
+    static constexpr uint8_t current_channels = Currents;
+    static constexpr float amps_per_count = 0.0776f;
+    static constexpr float smoothing = 0.95f;
+};
+
+#define WINDOWS 200
+#define ROUNDS 20
+#define TABLE 4096              // Synthetic samples, power of two
+
+static int16_t table[TABLE];
+static uint32_t k = 0;
+
+static double nowNs() {
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t ticks() {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Timing {
+    double ns;
+    double cycles;
+};
+
+// Best of several rounds, so a preempted round does not count
+template <class Run>
+static Timing best(Run run) {
+    Timing t = {1e30, 1e30};
+    for (int round = 0; round < ROUNDS; round++) {
+        double t0 = nowNs();
+        uint64_t c0 = ticks();
+        for (int w = 0; w < WINDOWS; w++) run();
+        uint64_t c1 = ticks();
+        double t1 = nowNs();
+        t.ns = fmin(t.ns, (t1 - t0) / WINDOWS);
+        t.cycles = fmin(t.cycles, (double)(c1 - c0) / WINDOWS);
+    }
+    return t;
+}
+
+static void printRow(const char* name, Timing fixed, Timing runtime) {
+    printf("%-22s %10.0f %10.0f %12.0f %12.0f %7.1f%%\n", name, fixed.ns, runtime.ns, fixed.cycles,
+           runtime.cycles, 100.0 * (runtime.ns - fixed.ns) / runtime.ns);
+}
+
+template <uint8_t Voltages, uint8_t Currents>
+static void benchFrames(const char* name, float& checksum) {
+    typedef BenchMeter<Voltages, Currents> Meter;
+    const uint8_t voltage_pins[PHASES] = {39, Voltages > 1 ? (uint8_t)32 : NO_PIN, Voltages > 2 ? (uint8_t)33 : NO_PIN};
+    const uint8_t current_pins[PHASES] = {36, Currents > 1 ? (uint8_t)34 : NO_PIN, Currents > 2 ? (uint8_t)35 : NO_PIN};
+    auto readPin = [](uint8_t pin) { return (int16_t)(table[k++ & (TABLE - 1)] + pin); };
+
+    ThreePhaseMeter meter;
+    meter.setDerivedVoltage(Voltages < PHASES);
+    meter.setScales(0.082f, Meter::amps_per_count);
+    Timing fixed = best([&]() {
+        meter.beginWindow();
+        sampleFrames<Meter>(meter, voltage_pins, current_pins, readPin);
+        meter.endWindow(20000);
+    });
+    Timing runtime = best([&]() {
+        meter.beginWindow();
+        sampleFrames(meter, voltage_pins, current_pins, readPin, Meter::frames);
+        meter.endWindow(20000);
+    });
+    printRow(name, fixed, runtime);
+    checksum += meter.getPhase(PHASE_A).current_a;
+}
+
+int main() {
+    for (int i = 0; i < TABLE; i++) {
+        table[i] = (int16_t)lround(1880 + 900 * sin(2 * M_PI * i / 1480.0) + (i * 7919 % 9) - 4);
+    }
+    typedef BenchMeter<1, PHASES> Meter;
+    auto read = []() { return table[k++ & (TABLE - 1)]; };
+    float checksum = 0;
+
+    printf("%-22s %10s %10s %12s %12s %8s\n", "window", "fixed ns", "runtime ns", "fixed cyc", "runtime cyc", "saved");
+    CtDetector window;
+    Timing fixed = best([&]() {
+        window.beginWindow();
+        sampleWindow<Meter>(window, read);
+        window.endWindow(4);
+    });
+    Timing runtime = best([&]() {
+        window.beginWindow();
+        sampleWindow(window, read, Meter::samples);
+        window.endWindow(4);
+    });
+    printRow("single-phase samples", fixed, runtime);
+    checksum += window.getVariance();
+
+    benchFrames<1, PHASES>("3ph derived V, 3 CT", checksum);
+    benchFrames<PHASES, PHASES>("3ph wired V, 3 CT", checksum);
+    benchFrames<1, 1>("3ph derived V, 1 CT", checksum);
+#ifndef HAVE_TSC
+    printf("(no cycle counter on this host)\n");
+#endif
+    printf("(checksum %.3f)\n", checksum);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Host test of LoadEventDetector with the example sketch's signatures.
+// A scripted evening switches appliances on and off over a small resistive
+// base load, and the detector must name each step. The script is run twice:
+//   - three-phase, where each window carries summed P and Q;
+//   - single-phase, where a window carries only V x I, the magnitude of
+//     the summed S, and no Q.
+// The single-phase run checks that reactive loads such as the fridge and
+// microwave still match with and without other loads running.
+//
+//   g++ -O2 -I.. load_event_test.cpp ../load_events.cpp -o load_event_test
+//   ./load_event_test
+
+#include "load_events.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BASE_W 40.0f            // Resistive standby load
+#define NOISE_W 3.0f            // Window noise, +/- W
+#define HOLD_WINDOWS 30         // Windows between switching actions
+
+struct Appliance {
+    const char* name;
+    float p;
+    float q;
+    bool signature;             // In the sketch's table
+};
+
+// Same table as setup() in the example sketch, plus a load it does not know
+static const Appliance APPLIANCES[] = {
+    {"Kettle", 2000, 0, true},
+    {"Fridge", 120, 90, true},
+    {"Microwave", 1200, 350, true},
+    {"Heater", 1500, 0, true},
+    {"Toaster", 800, 0, false},
+};
+#define APPLIANCE_COUNT (sizeof(APPLIANCES) / sizeof(APPLIANCES[0]))
+
+struct Step {
+    uint8_t appliance;
+    bool on;
+};
+
+// Fridge alone, then under kettle and heater, microwave over a resistive load
+static const Step SCRIPT[] = {
+    {1, true}, {1, false},
+    {0, true}, {1, true}, {0, false}, {1, false},
+    {3, true}, {2, true}, {1, true}, {2, false}, {1, false}, {3, false},
+    {2, true}, {2, false},
+    {4, true}, {4, false},
+};
+#define SCRIPT_LENGTH (sizeof(SCRIPT) / sizeof(SCRIPT[0]))
+
+static uint32_t rng = 7;
+
+static float noise() {
+    rng = rng * 1664525u + 1013904223u;
+    return NOISE_W * ((rng >> 8) / 8388608.0f - 1.0f);
+}
+
+static bool run(bool three_phase) {
+    LoadEventDetector detector;
+    for (const Appliance& a : APPLIANCES) {
+        if (a.signature) detector.addSignature(a.name, a.p, a.q);
+    }
+
+    bool running[APPLIANCE_COUNT] = {};
+    uint32_t now = 0;
+    uint32_t seen = 0;
+    bool ok = true;
+    printf("%s:\n", three_phase ? "three-phase (P and Q)" : "single-phase (V x I only)");
+
+    for (int s = -1; s < (int)SCRIPT_LENGTH; s++) {
+        if (s >= 0) running[SCRIPT[s].appliance] = SCRIPT[s].on;
+        float p = BASE_W, q = 0;
+        for (uint8_t a = 0; a < APPLIANCE_COUNT; a++) {
+            if (!running[a]) continue;
+            p += APPLIANCES[a].p;
+            q += APPLIANCES[a].q;
+        }
+
+        for (int w = 0; w < HOLD_WINDOWS; w++, now++) {
+            if (three_phase) {
+                detector.update(now, p + noise(), q + noise(), true);
+            } else {
+                detector.update(now, sqrtf(p * p + q * q) + noise(), 0, false);
+            }
+        }
+        if (s < 0) continue;    // Settling on the base load
+
+        const Appliance& want = APPLIANCES[SCRIPT[s].appliance];
+        LoadEvent event;
+        bool logged = detector.getTotalEvents() == seen + 1 && detector.getEvent(0, event);
+        seen = detector.getTotalEvents();
+        const char* got = !logged ? "no event" :
+                          event.signature == UNKNOWN_LOAD ? "Unknown" : detector.getSignature(event.signature).name;
+        bool pass = logged && event.on == SCRIPT[s].on &&
+                    strcmp(got, want.signature ? want.name : "Unknown") == 0;
+        printf("  %-9s %-3s step %8.1f W  -> %-9s %s\n", want.name, SCRIPT[s].on ? "on" : "off",
+               logged ? event.delta_p : 0.0f, got, pass ? "ok" : "FAIL");
+        ok = ok && pass;
+    }
+
+    for (uint8_t i = 0; i < detector.getSignatureCount(); i++) {
+        ok = ok && !detector.isApplianceOn(i);  // Everything was switched off again
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = run(true);
+    ok = run(false) && ok;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Host test of QuantileSketch against exact quantiles. A day of 100 ms
+// windows is drawn from several current distributions and the sketch's
+// p50, p95 and p99 are compared with the sorted samples at the same rank.
+// Each must be within SKETCH_RELATIVE_ERROR. The day is also split across
+// two sketches and merged, which must give the same answers.
+//
+//   g++ -O2 -I.. quantile_sketch_test.cpp ../quantile_sketch.cpp -o quantile_sketch_test
+//   ./quantile_sketch_test [samples]
+
+#include "quantile_sketch.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define DAY_WINDOWS 864000      // 100 ms windows in a day
+
+enum Shape { UNIFORM, LOGNORMAL, EXPONENTIAL, STANDBY_AND_LOAD, IDLE_HEAVY, BUCKET_EDGES };
+
+static const struct { Shape shape; const char* name; } SHAPES[] = {
+    {UNIFORM, "uniform 0.1-30 A"},
+    {LOGNORMAL, "lognormal"},
+    {EXPONENTIAL, "exponential"},
+    {STANDBY_AND_LOAD, "standby + load"},
+    {IDLE_HEAVY, "60% idle"},
+    {BUCKET_EDGES, "bucket edges"},
+};
+
+static const float QUANTILES[] = {0.50f, 0.95f, 0.99f};
+
+static float draw(Shape shape, std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    switch (shape) {
+    case UNIFORM:
+        return 0.1f + 29.9f * unit(rng);
+    case LOGNORMAL:
+        return std::lognormal_distribution<float>(0.5f, 1.2f)(rng);
+    case EXPONENTIAL:
+        return std::exponential_distribution<float>(0.25f)(rng);
+    case STANDBY_AND_LOAD:
+        // Mostly a 40 mA standby draw, with a kettle-sized load 8% of the time
+        return unit(rng) < 0.92f ? 0.04f + 0.01f * unit(rng) : 9.0f + 0.5f * unit(rng);
+    case IDLE_HEAVY:
+        // Readings at or below the sketch minimum land in its idle count
+        return unit(rng) < 0.6f ? 0.0f : 0.2f + 5.0f * unit(rng);
+    case BUCKET_EDGES: {
+        // Worst case for the midpoint estimate: values on a bucket boundary
+        const float gamma = (1.0f + SKETCH_RELATIVE_ERROR) / (1.0f - SKETCH_RELATIVE_ERROR);
+        return SKETCH_MIN_CURRENT * powf(gamma, (float)(rng() % 250));
+    }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int samples = argc > 1 ? atoi(argv[1]) : DAY_WINDOWS;
+    if (samples < 2) samples = DAY_WINDOWS;
+
+    bool ok = true;
+    printf("%-18s %5s %10s %10s %8s %8s\n", "distribution", "q", "exact", "sketch", "error %", "merged");
+    for (const auto& s : SHAPES) {
+        std::mt19937 rng(2024);
+        std::vector<float> values(samples);
+        QuantileSketch whole, first, second;
+        for (int n = 0; n < samples; n++) {
+            values[n] = draw(s.shape, rng);
+            whole.add(values[n]);
+            (n < samples / 2 ? first : second).add(values[n]);
+        }
+        std::sort(values.begin(), values.end());
+        first.merge(second);
+
+        for (float q : QUANTILES) {
+            float exact = values[(uint32_t)(q * (samples - 1))];   // Same rank as the sketch
+            float estimate = whole.quantile(q);
+            float error = exact > 0 ? fabsf(estimate - exact) / exact : fabsf(estimate);
+            bool merged = first.quantile(q) == estimate;
+            bool pass = error <= SKETCH_RELATIVE_ERROR && merged;
+            printf("%-18s %5.2f %10.4f %10.4f %8.3f %8s%s\n", s.name, q, exact, estimate,
+                   100 * error, merged ? "same" : "DIFFERS", pass ? "" : "  FAIL");
+            ok = ok && pass;
+        }
+    }
+
+    printf("%u bytes per sketch\n", QuantileSketch::getMemoryBytes());
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// Host stress test of MeasurementSnapshot: one writer thread publishes as
+// fast as it can while reader threads copy and check every field against
+// the window number it was derived from. Any torn copy is counted.
+//
+//   g++ -O2 -pthread -I.. snapshot_stress.cpp ../measurement_snapshot.cpp -o snapshot_stress
+//   ./snapshot_stress [seconds] [readers]
+
+#include "measurement_snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static Measurement make(uint32_t window) {
+    Measurement m;
+    memset(&m, 0, sizeof(m));
+    m.window = window;
+    m.unix_time = window * 3u;
+    m.voltage_v = (float)(window % 1000) + 0.5f;
+    m.current_a = (float)(window % 777) * 0.25f;
+    m.power_w = -(float)(window % 5000);
+    m.power_factor = (window & 1) ? 1.0f : -1.0f;
+    m.energy_kwh = window * 0.125;
+    m.flags = window ^ 0xA5A5A5A5u;
+    return m;
+}
+
+static bool consistent(const Measurement& m) {
+    Measurement expect = make(m.window);
+    return memcmp(&m, &expect, sizeof(m)) == 0;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int readers = argc > 2 ? atoi(argv[2]) : 3;
+
+    MeasurementSnapshot snapshot;
+    snapshot.publish(make(0));
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0), torn(0), failed(0), regressions(0);
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&]() {
+            uint64_t n = 0, bad = 0, fail = 0, back = 0;
+            uint32_t last = 0;
+            Measurement m;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!snapshot.read(m)) {
+                    fail++;
+                    continue;
+                }
+                if (!consistent(m)) bad++;
+                if (m.window < last) back++;    // Windows never go backwards
+                last = m.window;
+                n++;
+            }
+            reads += n;
+            torn += bad;
+            failed += fail;
+            regressions += back;
+        });
+    }
+
+    uint32_t window = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; i++) {
+            snapshot.publish(make(++window));
+        }
+    }
+    stop = true;
+    for (std::thread& t : threads) t.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%u publishes (%.1f M/s), %llu reads by %d readers (%.1f M/s)\n",
+           window, window / elapsed / 1e6, (unsigned long long)reads.load(), readers,
+           reads.load() / elapsed / 1e6);
+    printf("retries %u, failed reads %llu, torn copies %llu, out of order %llu\n",
+           snapshot.getRetries(), (unsigned long long)failed.load(),
+           (unsigned long long)torn.load(), (unsigned long long)regressions.load());
+    bool ok = torn.load() == 0 && regressions.load() == 0;
+    printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// Host test of TariffEngine on a virtual clock. The C library's POSIX TZ
+// rules are the reference (they need no tz database):
+//   - the UTC offset is checked every minute from 2026 to 2040 for EU, UK,
+//     US and fixed zones;
+//   - band lookups are checked every minute against the example
+//     schedule, resolved from the reference local time. New Year and
+//     Christmas are registered once as every-year holidays, Easter
+//     Monday 2030 as a dated one;
+//   - 1 kW is metered in 100 ms steps across the spring and autumn DST
+//     days and New Year. Each local day must hold 23, 25 or 24 kWh, and
+//     each band register must equal a reference split to the milli-joule.
+//
+//   g++ -O2 -I.. tariff_clock_test.cpp ../tariff.cpp ../energy_accumulator.cpp -o tariff_clock_test
+//   ./tariff_clock_test
+
+#include "tariff.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FIRST_YEAR 2026
+#define LAST_YEAR 2040
+#define STEP_MS 100
+#define POWER_W 1000.0f
+
+struct Zone {
+    const char* name;
+    const char* tz;             // POSIX TZ string used as the reference
+    int32_t utc_offset_s;
+    uint8_t dst_rule;
+};
+
+static const Zone ZONES[] = {
+    {"CET/CEST", "CET-1CEST,M3.5.0,M10.5.0/3", 3600, DST_EU},
+    {"GMT/BST", "GMT0BST,M3.5.0/1,M10.5.0", 0, DST_EU},
+    {"EET/EEST", "EET-2EEST,M3.5.0/3,M10.5.0/4", 7200, DST_EU},
+    {"EST/EDT", "EST5EDT,M3.2.0,M11.1.0", -18000, DST_US},
+    {"PST/PDT", "PST8PDT,M3.2.0,M11.1.0", -28800, DST_US},
+    {"JST", "JST-9", 32400, DST_NONE},
+};
+
+static uint8_t off_peak, mid_peak, on_peak;
+
+// Same schedule as setupTariff() in the example sketch
+static bool setupSchedule(TariffEngine& tariff, const Zone& zone) {
+    off_peak = tariff.addBand("Off", 0.10);
+    mid_peak = tariff.addBand("Mid", 0.15);
+    on_peak = tariff.addBand("Peak", 0.30);
+    tariff.setSeason(0, 10, 3);
+    tariff.setSeason(1, 4, 9);
+    for (uint8_t season = 0; season < 2; season++) {
+        tariff.setBand(season, DAY_WEEKDAY, 0, 0, off_peak);
+        tariff.setBand(season, DAY_WEEKDAY, 700, 2300, mid_peak);
+        tariff.setBand(season, DAY_WEEKEND, 0, 0, off_peak);
+        tariff.setBand(season, DAY_HOLIDAY, 0, 0, off_peak);
+    }
+    tariff.setBand(0, DAY_WEEKDAY, 1700, 2100, on_peak);
+    tariff.setBand(1, DAY_WEEKDAY, 1200, 1600, on_peak);
+    bool ok = tariff.addHoliday(0, 1, 1) && tariff.addHoliday(0, 12, 25) && tariff.addHoliday(2030, 4, 22);
+    tariff.setTimezone(zone.utc_offset_s, zone.dst_rule);
+    return ok;
+}
+
+static void useZone(const Zone& zone) {
+    setenv("TZ", zone.tz, 1);
+    tzset();
+}
+
+static struct tm localOf(uint32_t unix_time) {
+    time_t t = unix_time;
+    struct tm local;
+    localtime_r(&t, &local);
+    return local;
+}
+
+static uint8_t expectedBand(const struct tm& local) {
+    bool holiday = (local.tm_mon == 0 && local.tm_mday == 1) || (local.tm_mon == 11 && local.tm_mday == 25) ||
+                   (local.tm_year == 2030 - 1900 && local.tm_mon == 3 && local.tm_mday == 22);
+    if (holiday) return off_peak;
+    if (local.tm_wday == 0 || local.tm_wday == 6) return off_peak;
+    int minutes = local.tm_hour * 60 + local.tm_min;
+    bool summer = local.tm_mon >= 3 && local.tm_mon <= 8;
+    int peak_from = summer ? 12 * 60 : 17 * 60;
+    int peak_to = summer ? 16 * 60 : 21 * 60;
+    if (minutes >= peak_from && minutes < peak_to) return on_peak;
+    if (minutes >= 7 * 60 && minutes < 23 * 60) return mid_peak;
+    return off_peak;
+}
+
+static uint32_t utcOf(int year, int month, int day) {
+    return (uint32_t)TariffEngine::daysFromCivil(year, month, day) * 86400u;
+}
+
+// Local midnight of the given civil day, found by stepping the reference
+static uint32_t localMidnight(int year, int month, int day) {
+    uint32_t t = utcOf(year, month, day) - 86400;
+    for (;;) {
+        struct tm local = localOf(t);
+        if (local.tm_year + 1900 == year && local.tm_mon + 1 == month && local.tm_mday == day &&
+            local.tm_hour == 0 && local.tm_min == 0) {
+            return t;
+        }
+        t += 60;
+    }
+}
+
+// Every minute of the span: offset and band against the reference
+static bool checkMinutes(const Zone& zone, uint32_t& checked) {
+    TariffEngine tariff;
+    if (!setupSchedule(tariff, zone)) {
+        printf("%-9s holiday rejected\n", zone.name);
+        return false;
+    }
+    uint32_t offset_errors = 0, band_errors = 0;
+    uint32_t end = utcOf(LAST_YEAR + 1, 1, 1);
+    for (uint32_t t = utcOf(FIRST_YEAR, 1, 1); t < end; t += 60) {
+        struct tm local = localOf(t);
+        uint8_t band = tariff.lookup(t);
+        if ((int32_t)(tariff.toLocal(t) - t) != local.tm_gmtoff) {
+            if (offset_errors++ < 3) printf("  offset mismatch at %u\n", t);
+        }
+        if (band != expectedBand(local)) {
+            if (band_errors++ < 3) printf("  band mismatch at %u: got %u\n", t, band);
+        }
+        checked++;
+    }
+    printf("%-9s offsets %s, bands %s\n", zone.name, offset_errors ? "FAIL" : "ok", band_errors ? "FAIL" : "ok");
+    return offset_errors == 0 && band_errors == 0;
+}
+
+// 1 kW over one local day in 100 ms steps: day length and band split
+static bool checkDay(const Zone& zone, int year, int month, int day, float want_kwh) {
+    TariffEngine tariff;
+    setupSchedule(tariff, zone);            // Holidays already checked
+    EnergyAccumulator reference[MAX_TARIFF_BANDS];
+    uint32_t from = localMidnight(year, month, day);
+    int32_t next = TariffEngine::daysFromCivil(year, month, day) + 1;
+    int32_t ny;
+    uint8_t nm, nd;
+    TariffEngine::civilFromDays(next, ny, nm, nd);
+    uint32_t to = localMidnight(ny, nm, nd);
+
+    for (uint64_t ms = (uint64_t)from * 1000; ms < (uint64_t)to * 1000; ms += STEP_MS) {
+        uint32_t t = (uint32_t)(ms / 1000);
+        tariff.addEnergy(t, POWER_W, STEP_MS);
+        reference[expectedBand(localOf(t))].add(POWER_W, STEP_MS);
+    }
+
+    double total = 0;
+    bool ok = true;
+    for (uint8_t b = 0; b < tariff.getBandCount(); b++) {
+        total += tariff.getBandKWh(b);
+        ok = ok && tariff.getBandKWh(b) == reference[b].getKWh();
+    }
+    ok = ok && total > want_kwh - 1e-6 && total < want_kwh + 1e-6;
+    printf("%-9s %04d-%02d-%02d %6.3f kWh (off %6.3f, mid %6.3f, peak %6.3f) %s\n", zone.name, year, month,
+           day, total, tariff.getBandKWh(off_peak), tariff.getBandKWh(mid_peak), tariff.getBandKWh(on_peak),
+           ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+    uint32_t checked = 0;
+    for (const Zone& zone : ZONES) {
+        useZone(zone);
+        ok = checkMinutes(zone, checked) && ok;
+    }
+    printf("%u minute checks\n\n", checked);
+
+    // Spring forward, fall back, the weekday after, New Year's Eve into a
+    // holiday, and the recurring and dated holidays in later years
+    for (const Zone& zone : ZONES) {
+        useZone(zone);
+        if (zone.dst_rule == DST_EU) {
+            ok = checkDay(zone, 2026, 3, 29, 23) && ok;
+            ok = checkDay(zone, 2026, 3, 30, 24) && ok;
+            ok = checkDay(zone, 2026, 10, 25, 25) && ok;
+            ok = checkDay(zone, 2026, 10, 26, 24) && ok;
+        } else if (zone.dst_rule == DST_US) {
+            ok = checkDay(zone, 2026, 3, 8, 23) && ok;
+            ok = checkDay(zone, 2026, 3, 9, 24) && ok;
+            ok = checkDay(zone, 2026, 11, 1, 25) && ok;
+            ok = checkDay(zone, 2026, 11, 2, 24) && ok;
+        }
+        ok = checkDay(zone, 2026, 12, 31, 24) && ok;
+        ok = checkDay(zone, 2027, 1, 1, 24) && ok;
+        ok = checkDay(zone, 2030, 4, 22, 24) && ok;
+        ok = checkDay(zone, 2035, 12, 25, 24) && ok;
+        ok = checkDay(zone, 2039, 1, 3, 24) && ok;
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}